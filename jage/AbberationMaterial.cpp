@@ -22,7 +22,7 @@ AbberationMaterial::~AbberationMaterial()
 {
 }
 
-void AbberationMaterial::bind()
+void AbberationMaterial::bind() const
 {
 	m_shader->bind();
 
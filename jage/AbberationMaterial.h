@@ -8,7 +8,7 @@ public:
 	AbberationMaterial();
 	~AbberationMaterial();
 
-	void bind() override;
+	void bind() const override;
 
 	void setChromaticAberration(float chromaticAberration);
 	float getChromaticAberration() const;
@@ -0,0 +1,106 @@
+#include "BoundingVolume.h"
+
+#include <algorithm>
+
+BoundingVolume::BoundingVolume() :
+	min(0.0f), max(0.0f), center(0.0f), radius(0.0f), m_isEmpty(true)
+{
+}
+
+BoundingVolume BoundingVolume::fromPoints(const std::vector<vec3>& points)
+{
+	BoundingVolume result;
+	if (points.empty()) {
+		return result;
+	}
+
+	result.min = points[0];
+	result.max = points[0];
+	for (const auto& point : points) {
+		result.min = glm::min(result.min, point);
+		result.max = glm::max(result.max, point);
+	}
+
+	// sphere around box center is not minimal, but it is
+	// much tighter than sphere around box corners
+	result.center = (result.min + result.max) * 0.5f;
+
+	float squaredRadius = 0.0f;
+	for (const auto& point : points) {
+		const vec3 offset = point - result.center;
+		squaredRadius = std::max(squaredRadius, glm::dot(offset, offset));
+	}
+	result.radius = std::sqrt(squaredRadius);
+
+	result.m_isEmpty = false;
+	return result;
+}
+
+BoundingVolume BoundingVolume::transformed(const mat4& transformation) const
+{
+	if (m_isEmpty) {
+		return *this;
+	}
+
+	BoundingVolume result;
+
+	// box is transformed as center and extents, extents are
+	// projected on world axes by absolute values of rotation
+	const vec3 boxCenter = vec3(transformation * vec4((min + max) * 0.5f, 1.0f));
+	const vec3 boxExtents = (max - min) * 0.5f;
+
+	vec3 extents(0.0f);
+	for (glm::length_t i = 0; i < 3; ++i) {
+		extents += glm::abs(vec3(transformation[i])) * boxExtents[i];
+	}
+
+	result.min = boxCenter - extents;
+	result.max = boxCenter + extents;
+
+	// sphere radius is scaled by the largest axis scale
+	const float scale = std::max(glm::length(vec3(transformation[0])), 
+		std::max(glm::length(vec3(transformation[1])), glm::length(vec3(transformation[2]))));
+
+	result.center = vec3(transformation * vec4(center, 1.0f));
+	result.radius = radius * scale;
+
+	result.m_isEmpty = false;
+	return result;
+}
+
+void BoundingVolume::merge(const BoundingVolume& other)
+{
+	if (other.m_isEmpty) {
+		return;
+	}
+
+	if (m_isEmpty) {
+		*this = other;
+		return;
+	}
+
+	min = glm::min(min, other.min);
+	max = glm::max(max, other.max);
+
+	const vec3 offset = other.center - center;
+	const float distance = glm::length(offset);
+
+	if (distance + other.radius <= radius) {
+		return;
+	}
+
+	if (distance + radius <= other.radius) {
+		center = other.center;
+		radius = other.radius;
+		return;
+	}
+
+	const float mergedRadius = (distance + radius + other.radius) * 0.5f;
+	center += offset * ((mergedRadius - radius) / distance);
+	radius = mergedRadius;
+}
+
+bool BoundingVolume::isEmpty() const
+{
+	return m_isEmpty;
+}
\ No newline at end of file
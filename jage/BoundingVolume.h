@@ -0,0 +1,32 @@
+#pragma once
+
+#include <vector>
+
+#include "Math.h"
+
+// Axis aligned box and sphere enclosing some geometry
+struct BoundingVolume
+{
+	BoundingVolume();
+
+	// Calculates box and sphere around all points
+	// Empty volume is returned if there are no points
+	static BoundingVolume fromPoints(const std::vector<vec3>& points);
+
+	// Returns volume enclosing this volume after transformation
+	BoundingVolume transformed(const mat4& transformation) const;
+
+	// Extends this volume to enclose other one
+	void merge(const BoundingVolume& other);
+
+	bool isEmpty() const;
+
+	vec3 min;
+	vec3 max;
+
+	vec3 center;
+	float radius;
+
+private:
+	bool m_isEmpty;
+};
\ No newline at end of file
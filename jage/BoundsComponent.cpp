@@ -0,0 +1,33 @@
+#include "BoundsComponent.h"
+
+BoundsComponent::BoundsComponent(const BoundingVolume & localBounds) :
+	m_localBounds(localBounds), m_isDirty(true)
+{
+}
+
+void BoundsComponent::setLocalBounds(const BoundingVolume & localBounds)
+{
+	m_localBounds = localBounds;
+	m_isDirty = true;
+}
+
+const BoundingVolume & BoundsComponent::getLocalBounds() const
+{
+	return m_localBounds;
+}
+
+void BoundsComponent::updateWorldBounds(const mat4 & worldTransformation)
+{
+	m_worldBounds = m_localBounds.transformed(worldTransformation);
+	m_isDirty = false;
+}
+
+const BoundingVolume & BoundsComponent::getWorldBounds() const
+{
+	return m_worldBounds;
+}
+
+bool BoundsComponent::isDirty() const
+{
+	return m_isDirty;
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "BoundingVolume.h"
+
+// World space bounds of entity geometry, updated by BoundsSystem
+// whenever world transformation of entity changes
+class BoundsComponent
+{
+public:
+	BoundsComponent(const BoundingVolume& localBounds = BoundingVolume());
+
+	void setLocalBounds(const BoundingVolume& localBounds);
+	const BoundingVolume& getLocalBounds() const;
+
+	void updateWorldBounds(const mat4& worldTransformation);
+	const BoundingVolume& getWorldBounds() const;
+
+	// True if local bounds were changed after last world bounds update
+	bool isDirty() const;
+
+private:
+	BoundingVolume m_localBounds;
+	BoundingVolume m_worldBounds;
+
+	bool m_isDirty;
+};
\ No newline at end of file
@@ -0,0 +1,33 @@
+#include "BoundsSystem.h"
+
+#include "GameObject.h"
+
+void BoundsSystem::init()
+{
+	writes<BoundsComponent>();
+}
+
+void BoundsSystem::update(const float dt)
+{
+	if (m_transformSystem != nullptr) {
+		m_manager->parallelEach<BoundsComponent>([this](EntityId id, BoundsComponent& component) {
+			if (component.isDirty() || m_transformSystem->isWorldTransformationChanged(id)) {
+				component.updateWorldBounds(m_transformSystem->getWorldTransformation(id));
+			}
+		});
+		return;
+	}
+
+	m_manager->each<BoundsComponent>([this](EntityId id, BoundsComponent& component) {
+		GameObject* object = m_manager->getObject(id);
+		component.updateWorldBounds(object != nullptr ? object->getGlobalTransformation() : mat4(1.0f));
+	});
+}
+
+void BoundsSystem::setTransformSystem(std::shared_ptr<TransformSystem> transformSystem)
+{
+	m_transformSystem = transformSystem;
+	if (transformSystem != nullptr) {
+		dependsOn(transformSystem.get());
+	}
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "EntityManager.h"
+#include "TransformSystem.h"
+#include "BoundsComponent.h"
+
+// Keeps world bounds of entities in sync with their world transformations
+// Bounds are recalculated only for entities whose world transformation was
+// changed by the last TransformSystem update or whose local bounds changed
+class BoundsSystem : public EntitySystem
+{
+public:
+	void init() override;
+
+	void update(const float dt) override;
+
+	// Without transform system bounds are recalculated every update
+	void setTransformSystem(std::shared_ptr<TransformSystem> transformSystem);
+
+private:
+	std::shared_ptr<TransformSystem> m_transformSystem;
+};
\ No newline at end of file
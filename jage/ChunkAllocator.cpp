@@ -0,0 +1,111 @@
+#include "ChunkAllocator.h"
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+void * HugePageChunkAllocator::allocate(size_t size)
+{
+#ifdef _WIN32
+	// large pages require SeLockMemoryPrivilege, so only regular pages are used
+	void* chunk = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	void* chunk = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (chunk == MAP_FAILED) {
+		chunk = nullptr;
+	}
+#ifdef MADV_HUGEPAGE
+	else {
+		madvise(chunk, size, MADV_HUGEPAGE);
+	}
+#endif
+#endif
+
+	if (chunk == nullptr) {
+		throw std::bad_alloc();
+	}
+
+	return chunk;
+}
+
+void HugePageChunkAllocator::deallocate(void * chunk, size_t size)
+{
+#ifdef _WIN32
+	VirtualFree(chunk, 0, MEM_RELEASE);
+#else
+	munmap(chunk, size);
+#endif
+}
+
+std::mutex ArenaChunkAllocator::m_mutex;
+
+std::vector<std::pair<char*, size_t>> ArenaChunkAllocator::m_blocks;
+size_t ArenaChunkAllocator::m_blockOffset = 0;
+
+std::unordered_map<size_t, std::vector<void*>> ArenaChunkAllocator::m_releasedChunks;
+
+void * ArenaChunkAllocator::allocate(size_t size)
+{
+	typedef AlignedChunkAllocator<> BlockAllocator;
+
+	// all chunks start at cache line
+	size = (size + 63) & ~size_t(63);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	auto& releasedChunks = m_releasedChunks[size];
+	if (!releasedChunks.empty()) {
+		void* chunk = releasedChunks.back();
+		releasedChunks.pop_back();
+		return chunk;
+	}
+
+	if (m_blocks.empty() || m_blockOffset + size > m_blocks.back().second) {
+		const size_t blockSize = size > BLOCK_SIZE ? size : BLOCK_SIZE;
+		m_blocks.emplace_back(static_cast<char*>(BlockAllocator::allocate(blockSize)), blockSize);
+		m_blockOffset = 0;
+	}
+
+	void* chunk = m_blocks.back().first + m_blockOffset;
+	m_blockOffset += size;
+
+	return chunk;
+}
+
+void ArenaChunkAllocator::deallocate(void * chunk, size_t size)
+{
+	size = (size + 63) & ~size_t(63);
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_releasedChunks[size].push_back(chunk);
+}
+
+void ArenaChunkAllocator::reset()
+{
+	typedef AlignedChunkAllocator<> BlockAllocator;
+
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	for (auto& block : m_blocks) {
+		BlockAllocator::deallocate(block.first, block.second);
+	}
+
+	m_blocks.clear();
+	m_blockOffset = 0;
+	m_releasedChunks.clear();
+}
+
+size_t ArenaChunkAllocator::getReservedBytes()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	size_t result = 0;
+	for (auto& block : m_blocks) {
+		result += block.second;
+	}
+	return result;
+}
\ No newline at end of file
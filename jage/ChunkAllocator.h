@@ -0,0 +1,86 @@
+#pragma once
+
+#include <unordered_map>
+#include <cstddef>
+#include <vector>
+#include <mutex>
+#include <new>
+
+// Chunk allocators are policies of pools
+// Each of them has static allocate and deallocate functions
+
+// Allocates chunks aligned to specified number of bytes
+// Default alignment is the size of cache line
+template<size_t Alignment = 64>
+class AlignedChunkAllocator
+{
+public:
+	static void* allocate(size_t size)
+	{
+		return ::operator new(size, std::align_val_t(Alignment));
+	}
+
+	static void deallocate(void* chunk, size_t /*size*/)
+	{
+		::operator delete(chunk, std::align_val_t(Alignment));
+	}
+};
+
+
+// Allocates chunks directly from the system by pages
+// On Linux transparent huge pages are requested for them
+class HugePageChunkAllocator
+{
+public:
+	static void* allocate(size_t size);
+	static void deallocate(void* chunk, size_t size);
+};
+
+
+// Cuts chunks from large blocks and reuses released chunks of the same size
+// Blocks are returned to the system only by reset call
+class ArenaChunkAllocator
+{
+public:
+	static const size_t BLOCK_SIZE = 16 * 1024 * 1024;
+
+	static void* allocate(size_t size);
+	static void deallocate(void* chunk, size_t size);
+
+	// Frees all blocks, must be called only when no pool uses arena
+	static void reset();
+
+	// Returns size of all blocks in bytes
+	static size_t getReservedBytes();
+
+private:
+	static std::mutex m_mutex;
+
+	static std::vector<std::pair<char*, size_t>> m_blocks;
+	static size_t m_blockOffset;
+
+	static std::unordered_map<size_t, std::vector<void*>> m_releasedChunks;
+};
+
+
+// Chunk allocator of component type pools
+// Can be specialized to change allocator for some components
+template<typename T>
+struct ChunkAllocatorTraits
+{
+	typedef AlignedChunkAllocator<(alignof(T) > 64 ? alignof(T) : 64)> Allocator;
+};
+
+
+// Functions of chunk allocator policy
+struct ChunkAllocatorFunctions
+{
+	template<typename Allocator>
+	static ChunkAllocatorFunctions of()
+	{
+		return ChunkAllocatorFunctions{ &Allocator::allocate, &Allocator::deallocate };
+	}
+
+	void* (*allocate)(size_t size);
+	void (*deallocate)(void* chunk, size_t size);
+};
\ No newline at end of file
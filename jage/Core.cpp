@@ -34,6 +34,7 @@ void Core::init(const Parameters& parameters)
 	ResourceManager::init();
 	CursorManager::init(m_window.getSystemHandle());
 	FileManager::init<DefaultFileSystem>();
+	JobSystem::init();
 	
 	m_isInitialized = true;
 }
@@ -48,6 +49,7 @@ void Core::close()
 	CursorManager::close();
 	ResourceManager::close();
 	FileManager::close();
+	JobSystem::close();
 
 	m_window.close();
 
@@ -8,6 +8,7 @@
 #include "CursorManager.h"
 #include "SceneManager.h"
 #include "FileManager.h"
+#include "JobSystem.h"
 
 #include "SoundBufferFactory.h"
 #include "TextureFactory.h"
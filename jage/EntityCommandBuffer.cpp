@@ -0,0 +1,175 @@
+#include "EntityCommandBuffer.h"
+
+#include <algorithm>
+#include <numeric>
+
+#include "GameObject.h"
+
+namespace
+{
+	// version of entities which are not created yet
+	const uint32_t DEFERRED_VERSION = ~0U;
+}
+
+EntityCommandBuffer::EntityCommandBuffer(EntityManager * manager) :
+	m_manager(manager), m_createdCount(0)
+{
+}
+
+EntityId EntityCommandBuffer::create()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return EntityId(m_createdCount++, DEFERRED_VERSION);
+}
+
+void EntityCommandBuffer::destroy(EntityId id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_destroyedEntities.push_back(id);
+}
+
+void EntityCommandBuffer::playback()
+{
+	// recorded commands are taken out under the lock and applied without it,
+	// so event subscribers can record into this buffer during playback.
+	// Such commands are applied by the next playback
+	uint32_t createdCount = 0;
+	std::vector<EntityId> destroyedIds;
+	std::vector<Command> commands;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		std::swap(createdCount, m_createdCount);
+		destroyedIds.swap(m_destroyedEntities);
+		commands.swap(m_commands);
+	}
+
+	// split destroyed entities into existing and deferred ones
+	std::vector<bool> deferredDestroyed(createdCount, false);
+	std::vector<EntityId> destroyedEntities;
+	destroyedEntities.reserve(destroyedIds.size());
+
+	for (auto id : destroyedIds) {
+		if (isDeferred(id)) {
+			if (id.getIndex() < createdCount) {
+				deferredDestroyed[id.getIndex()] = true;
+			}
+		}
+		else if (m_manager->isValid(id)) {
+			destroyedEntities.push_back(id);
+		}
+	}
+
+	std::sort(destroyedEntities.begin(), destroyedEntities.end());
+	destroyedEntities.erase(std::unique(destroyedEntities.begin(), destroyedEntities.end()), destroyedEntities.end());
+
+	// create entities which survive this buffer
+	size_t survivedCount = std::count(deferredDestroyed.begin(), deferredDestroyed.end(), false);
+	std::vector<EntityId> createdEntities = m_manager->createMany(survivedCount);
+
+	m_createdEntities.assign(createdCount, EntityId::INVALID);
+	for (uint32_t i = 0, j = 0; i < createdCount; ++i) {
+		if (!deferredDestroyed[i]) {
+			m_createdEntities[i] = createdEntities[j++];
+		}
+	}
+
+	// only the last command for each component of each entity is applied
+	std::vector<size_t> order(commands.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::stable_sort(order.begin(), order.end(), [&commands](size_t a, size_t b) {
+		const Command& first = commands[a];
+		const Command& second = commands[b];
+		return first.id < second.id || (first.id == second.id && first.family < second.family);
+	});
+
+	std::vector<size_t> applied;
+	applied.reserve(order.size());
+	for (size_t i = 0; i < order.size(); ++i) {
+		if (i + 1 < order.size()) {
+			const Command& current = commands[order[i]];
+			const Command& next = commands[order[i + 1]];
+			if (current.id == next.id && current.family == next.family) {
+				continue;
+			}
+		}
+		applied.push_back(order[i]);
+	}
+
+	// components of the same type are applied together
+	std::sort(applied.begin(), applied.end(), [&commands](size_t a, size_t b) {
+		const Command& first = commands[a];
+		const Command& second = commands[b];
+		return first.family < second.family || (first.family == second.family && 
+			(first.type < second.type || (first.type == second.type && first.id < second.id)));
+	});
+
+	std::vector<EntityId> entities;
+	for (size_t i = 0; i < applied.size();) {
+		Command& first = commands[applied[i]];
+
+		entities.clear();
+		for (; i < applied.size(); ++i) {
+			Command& command = commands[applied[i]];
+			if (command.family != first.family || command.type != first.type) {
+				break;
+			}
+
+			EntityId id = resolve(command.id);
+			if (id == EntityId::INVALID ||
+				std::binary_search(destroyedEntities.begin(), destroyedEntities.end(), id))
+			{
+				continue;
+			}
+
+			if (command.type == ASSIGN) {
+				command.component->assign(m_manager, id);
+			}
+			entities.push_back(id);
+		}
+
+		if (first.type == ASSIGN) {
+			first.component->emitAssigned(m_manager, entities);
+		}
+		else {
+			first.component->removeMany(m_manager, entities);
+		}
+	}
+
+	m_manager->destroyMany(destroyedEntities);
+}
+
+const std::vector<EntityId>& EntityCommandBuffer::getCreatedEntities() const
+{
+	return m_createdEntities;
+}
+
+bool EntityCommandBuffer::isEmpty() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_createdCount == 0 && m_destroyedEntities.empty() && m_commands.empty();
+}
+
+bool EntityCommandBuffer::isDeferred(EntityId id)
+{
+	return id.getVersion() == DEFERRED_VERSION;
+}
+
+void EntityCommandBuffer::record(CommandType type, EntityId id, size_t family, std::unique_ptr<detail::BaseComponentCommand> component)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_commands.push_back(Command{ type, id, family, std::move(component) });
+}
+
+EntityId EntityCommandBuffer::resolve(EntityId id) const
+{
+	if (isDeferred(id)) {
+		return id.getIndex() < m_createdEntities.size() ? m_createdEntities[id.getIndex()] : EntityId::INVALID;
+	}
+
+	return m_manager->isValid(id) ? id : EntityId::INVALID;
+}
\ No newline at end of file
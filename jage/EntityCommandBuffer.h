@@ -0,0 +1,189 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+
+#include "EntityManager.h"
+
+namespace detail
+{
+	class BaseComponentCommand
+	{
+	public:
+		virtual ~BaseComponentCommand() {}
+
+		// Assigns component without events
+		virtual void assign(EntityManager* manager, EntityId id) = 0;
+
+		// Emits single event for components assigned to entities
+		virtual void emitAssigned(EntityManager* manager, const std::vector<EntityId>& entities) = 0;
+
+		// Emits single event and removes components of entities
+		virtual void removeMany(EntityManager* manager, const std::vector<EntityId>& entities) = 0;
+	};
+
+	template<typename T>
+	class TypedComponentCommand : public BaseComponentCommand
+	{
+	public:
+		void emitAssigned(EntityManager* manager, const std::vector<EntityId>& entities) override
+		{
+			if (!entities.empty() && manager->hasSubscribers<Events::OnComponentsAssigned<T>>()) {
+				manager->emit<Events::OnComponentsAssigned<T>>({ entities });
+			}
+		}
+
+		void removeMany(EntityManager* manager, const std::vector<EntityId>& entities) override
+		{
+			std::vector<EntityId> removed;
+			removed.reserve(entities.size());
+			for (auto id : entities) {
+				if (manager->hasComponent<T>(id)) {
+					removed.push_back(id);
+				}
+			}
+
+			if (!removed.empty() && manager->hasSubscribers<Events::OnComponentsRemoved<T>>()) {
+				manager->emit<Events::OnComponentsRemoved<T>>({ removed });
+			}
+
+			// subscribers could remove some of them
+			for (auto id : removed) {
+				if (manager->isValid(id) && manager->hasComponent<T>(id)) {
+					manager->eraseComponent<T>(id);
+				}
+			}
+		}
+
+	protected:
+		template<typename... Args>
+		static void emplace(EntityManager* manager, EntityId id, Args&&... args)
+		{
+			manager->emplaceComponent<T>(id, std::forward<Args>(args)...);
+		}
+	};
+
+	template<typename T>
+	class ComponentCommand : public TypedComponentCommand<T>
+	{
+	public:
+		template<typename... Args>
+		ComponentCommand(Args&&... args) :
+			m_component(std::forward<Args>(args)...)
+		{}
+
+		void assign(EntityManager* manager, EntityId id) override
+		{
+			TypedComponentCommand<T>::emplace(manager, id, std::move(m_component));
+		}
+
+	private:
+		T m_component;
+	};
+
+	// Shared components keep only their value until playback
+	template<typename T>
+	class ComponentCommand<Shared<T>> : public TypedComponentCommand<Shared<T>>
+	{
+	public:
+		template<typename... Args>
+		ComponentCommand(Args&&... args) :
+			m_value(std::forward<Args>(args)...)
+		{}
+
+		void assign(EntityManager* manager, EntityId id) override
+		{
+			TypedComponentCommand<Shared<T>>::emplace(manager, id, std::move(m_value));
+		}
+
+	private:
+		T m_value;
+	};
+
+	template<typename T>
+	class RemoveCommand : public TypedComponentCommand<T>
+	{
+	public:
+		void assign(EntityManager* manager, EntityId id) override {}
+	};
+}
+
+
+// Records structural changes and applies them later in one batch
+// Commands can be recorded from several threads at once.
+// On playback commands are coalesced: only the last assign or remove of
+// each component is applied, entities which are created and destroyed
+// in the same buffer are skipped, and everything else is applied
+// grouped by component type. Instead of per component events single
+// OnComponentsAssigned and OnComponentsRemoved events are emitted
+// for each component type
+class EntityCommandBuffer
+{
+public:
+	EntityCommandBuffer(EntityManager* manager);
+
+	// Reserves entity which will be created on playback
+	// Returned id can be used only with this buffer until playback
+	EntityId create();
+
+	void destroy(EntityId id);
+
+	template<typename T, typename... Args>
+	void assign(EntityId id, Args&&... args)
+	{
+		record(ASSIGN, id, EntityManager::getComponentFamily<T>(),
+			std::make_unique<detail::ComponentCommand<T>>(std::forward<Args>(args)...));
+	}
+
+	template<typename T>
+	void remove(EntityId id)
+	{
+		record(REMOVE, id, EntityManager::getComponentFamily<T>(),
+			std::make_unique<detail::RemoveCommand<T>>());
+	}
+
+	// Applies all recorded commands and clears buffer
+	// Must be called when nothing else uses entity manager
+	// Commands recorded by event subscribers during playback
+	// are applied by the next playback
+	void playback();
+
+	// Returns entities which were created during last playback
+	// in the order of create calls
+	const std::vector<EntityId>& getCreatedEntities() const;
+
+	bool isEmpty() const;
+
+	// Returns true if id was returned by create of command buffer
+	static bool isDeferred(EntityId id);
+
+private:
+	enum CommandType
+	{
+		ASSIGN,
+		REMOVE
+	};
+
+	struct Command
+	{
+		CommandType type;
+		EntityId id;
+		size_t family;
+		std::unique_ptr<detail::BaseComponentCommand> component;
+	};
+
+	void record(CommandType type, EntityId id, size_t family, std::unique_ptr<detail::BaseComponentCommand> component);
+
+	EntityId resolve(EntityId id) const;
+
+	EntityManager* m_manager;
+
+	mutable std::mutex m_mutex;
+
+	uint32_t m_createdCount;
+	std::vector<EntityId> m_destroyedEntities;
+	std::vector<Command> m_commands;
+
+	std::vector<EntityId> m_createdEntities;
+};
\ No newline at end of file
@@ -1,14 +1,40 @@
 #include "EntityManager.h"
 
+#include <chrono>
+
+#include "EntityCommandBuffer.h"
 #include "GameObject.h"
 
 #include "Log.h"
 
-size_t detail::BaseComponent::m_familyCounter = 0;
+std::atomic<size_t> detail::BaseComponent::m_familyCounter(0);
+std::atomic<size_t> detail::BaseEvent::m_familyCounter(0);
 const EntityId EntityId::INVALID;
+thread_local uint32_t EntityManager::m_lastUpdateVersion = 0;
+
+bool EntitySystem::conflictsWith(const EntitySystem & other) const
+{
+	if (std::find(m_dependencies.begin(), m_dependencies.end(), &other) != m_dependencies.end() ||
+		std::find(other.m_dependencies.begin(), other.m_dependencies.end(), this) != other.m_dependencies.end())
+	{
+		return true;
+	}
+
+	if (!m_hasDeclaredAccess || !other.m_hasDeclaredAccess) {
+		return true;
+	}
+
+	return (m_writeMask & (other.m_readMask | other.m_writeMask)).any() ||
+		(other.m_writeMask & m_readMask).any();
+}
 
 EntityManager::EntityManager() :
-	m_currentIndex(0)
+	m_currentIndex(0), m_hierarchyVersion(0), m_systemStagesChanged(false), m_changeVersion(1), m_eventMode(IMMEDIATE)
+{
+	m_commandBuffer = std::make_unique<EntityCommandBuffer>(this);
+}
+
+EntityManager::~EntityManager()
 {
 }
 
@@ -22,6 +48,28 @@ size_t EntityManager::getCapacity() const
 	return m_entityComponentMasks.size();
 }
 
+size_t EntityManager::getCommittedBytes() const
+{
+	size_t result = 0;
+	for (auto& pool : m_componentPools) {
+		if (pool != nullptr) {
+			result += pool->getCommittedBytes();
+		}
+	}
+	return result;
+}
+
+size_t EntityManager::getUsedBytes() const
+{
+	size_t result = 0;
+	for (auto& pool : m_componentPools) {
+		if (pool != nullptr) {
+			result += pool->getUsedBytes();
+		}
+	}
+	return result;
+}
+
 EntityId EntityManager::createId(uint32_t index) const
 {
 	return EntityId(index, m_entityVersions[index]);
@@ -34,6 +82,279 @@ bool EntityManager::isValid(EntityId id) const
 }
 
 std::shared_ptr<GameObject> EntityManager::create()
+{
+	EntityId id = allocateEntity();
+
+	m_gameObjects.construct(this, id);
+	std::shared_ptr<GameObject> gameObject = m_gameObjects.share(id.getIndex());
+	
+	if (hasSubscribers<Events::OnEntityCreated>()) {
+		emit<Events::OnEntityCreated>({ gameObject });
+	}
+
+	return gameObject;
+}
+
+void EntityManager::destroy(EntityId id)
+{
+	if (hasSubscribers<Events::OnEntityDestroyed>()) {
+		emit<Events::OnEntityDestroyed>({ get(id) });
+	}
+
+	uint32_t index = id.getIndex();
+	forEachComponent(m_entityComponentMasks[index], [this, id](size_t family) {
+		m_componentHelpers[family]->removeComponent(this, id);
+	});
+
+	m_gameObjects.release(index);
+	m_entityComponentMasks[index].reset();
+	m_entityVersions[index]++;
+	m_availableIndices.push_back(index);
+	std::push_heap(m_availableIndices.begin(), m_availableIndices.end(), std::greater<uint32_t>());
+	setAlive(index, false);
+	++m_hierarchyVersion;
+}
+
+void EntityManager::destroyMany(const EntityId * entities, size_t count)
+{
+	std::vector<EntityId> destroyedEntities;
+	destroyedEntities.reserve(count);
+	for (size_t i = 0; i < count; ++i) {
+		if (isValid(entities[i])) {
+			destroyedEntities.push_back(entities[i]);
+		}
+	}
+
+	std::sort(destroyedEntities.begin(), destroyedEntities.end());
+	destroyedEntities.erase(std::unique(destroyedEntities.begin(), destroyedEntities.end()), destroyedEntities.end());
+
+	if (destroyedEntities.empty()) {
+		return;
+	}
+
+	if (hasSubscribers<Events::OnEntitiesDestroyed>()) {
+		emit<Events::OnEntitiesDestroyed>({ destroyedEntities });
+	}
+
+	m_availableIndices.reserve(m_availableIndices.size() + destroyedEntities.size());
+	for (auto id : destroyedEntities) {
+		uint32_t index = id.getIndex();
+		forEachComponent(m_entityComponentMasks[index], [this, index](size_t family) {
+			resetComponentFlag(index, family);
+			m_componentPools[family]->erase(index);
+		});
+
+		m_gameObjects.release(index);
+		m_entityComponentMasks[index].reset();
+		m_entityVersions[index]++;
+		m_availableIndices.push_back(index);
+		std::push_heap(m_availableIndices.begin(), m_availableIndices.end(), std::greater<uint32_t>());
+		setAlive(index, false);
+	}
+	++m_hierarchyVersion;
+}
+
+void EntityManager::destroyMany(const std::vector<EntityId>& entities)
+{
+	destroyMany(entities.data(), entities.size());
+}
+
+std::shared_ptr<GameObject> EntityManager::get(EntityId id)
+{
+	return m_gameObjects.share(id.getIndex());
+}
+
+GameObject * EntityManager::getObject(EntityId id) const
+{
+	return m_gameObjects.get(id.getIndex());
+}
+
+GameObject * EntityManager::findByName(StringId name) const
+{
+	return m_gameObjects.find(name);
+}
+
+bool EntityManager::compact(size_t maxPools)
+{
+	size_t sortedCount = 0;
+	for (auto& pool : m_componentPools) {
+		if (pool == nullptr || pool->isSorted()) {
+			continue;
+		}
+
+		// order of owned pools is kept by their group
+		const size_t family = &pool - m_componentPools.data();
+		if (family < m_componentGroups.size() && m_componentGroups[family] != nullptr) {
+			continue;
+		}
+
+		if (sortedCount == maxPools) {
+			return false;
+		}
+
+		pool->sortByEntityIndex();
+		++sortedCount;
+	}
+
+	for (auto& query : m_queries) {
+		query->sortByEntityIndex();
+	}
+
+	return true;
+}
+
+const std::vector<uint32_t>* EntityManager::getCandidates(const ComponentMask & mask) const
+{
+	static const std::vector<uint32_t> empty;
+
+	const detail::CachedQuery* query = findQuery(mask);
+	if (query != nullptr) {
+		return &query->getEntityIndices();
+	}
+
+	const BasePool* smallest = nullptr;
+	for (size_t i = 0; i < MAX_COMPONENTS; ++i) {
+		if (!mask.test(i)) {
+			continue;
+		}
+
+		if (i >= m_componentPools.size() || m_componentPools[i] == nullptr) {
+			return &empty;
+		}
+
+		const BasePool* pool = m_componentPools[i].get();
+		if (smallest == nullptr || pool->getSize() < smallest->getSize()) {
+			smallest = pool;
+		}
+	}
+
+	return smallest != nullptr ? &smallest->getEntityIndices() : &empty;
+}
+
+const detail::CachedQuery * EntityManager::findQuery(const ComponentMask & mask) const
+{
+	for (auto& query : m_queries) {
+		if (query->getMask() == mask) {
+			return query.get();
+		}
+	}
+	return nullptr;
+}
+
+void EntityManager::addToQueries(uint32_t index, size_t family)
+{
+	if (family >= m_componentQueries.size()) {
+		return;
+	}
+
+	const ComponentMask& mask = m_entityComponentMasks[index];
+	for (auto* query : m_componentQueries[family]) {
+		if ((mask & query->getMask()) == query->getMask()) {
+			query->insert(index);
+		}
+	}
+}
+
+void EntityManager::chooseBitmaps(const ComponentMask & mask, size_t candidateCount, Bitmaps & bitmaps) const
+{
+	// candidates of single component are already exact
+	const size_t familyCount = mask.count();
+	if (familyCount < 2 || m_aliveEntities.size() * familyCount >= candidateCount) {
+		return;
+	}
+
+	forEachComponent(mask, [this, &bitmaps](size_t family) {
+		bitmaps.push_back(&m_componentBitmaps[family]);
+	});
+}
+
+void EntityManager::setComponentFlag(uint32_t index, size_t family)
+{
+	m_entityComponentMasks[index].set(family);
+	m_componentBitmaps[family][index / 64] |= 1ULL << (index % 64);
+	addToQueries(index, family);
+	addToGroup(index, family);
+}
+
+void EntityManager::setComponentFlags(const uint32_t * indices, size_t count, size_t family)
+{
+	const bool isTracked = (family < m_componentQueries.size() && !m_componentQueries[family].empty()) ||
+		(family < m_componentGroups.size() && m_componentGroups[family] != nullptr);
+
+	if (isTracked) {
+		for (size_t i = 0; i < count; ++i) {
+			setComponentFlag(indices[i], family);
+		}
+		return;
+	}
+
+	std::vector<uint64_t>& bitmap = m_componentBitmaps[family];
+	for (size_t i = 0; i < count; ++i) {
+		m_entityComponentMasks[indices[i]].set(family);
+		bitmap[indices[i] / 64] |= 1ULL << (indices[i] % 64);
+	}
+}
+
+void EntityManager::resetComponentFlag(uint32_t index, size_t family)
+{
+	removeFromGroup(index, family);
+	removeFromQueries(index, family);
+	m_componentBitmaps[family][index / 64] &= ~(1ULL << (index % 64));
+	m_entityComponentMasks[index].reset(family);
+}
+
+void EntityManager::removeFromQueries(uint32_t index, size_t family)
+{
+	if (family >= m_componentQueries.size()) {
+		return;
+	}
+
+	for (auto* query : m_componentQueries[family]) {
+		query->erase(index);
+	}
+}
+
+void EntityManager::addToGroup(uint32_t index, size_t family)
+{
+	if (family >= m_componentGroups.size() || m_componentGroups[family] == nullptr) {
+		return;
+	}
+
+	detail::OwningGroup* group = m_componentGroups[family];
+	if ((m_entityComponentMasks[index] & group->mask) != group->mask ||
+		m_componentPools[family]->find(index) < group->size)
+	{
+		return;
+	}
+
+	// entity is swapped with the first element after group in each pool
+	for (size_t owned : group->families) {
+		BasePool* pool = m_componentPools[owned].get();
+		pool->swap(pool->find(index), group->size);
+	}
+	++group->size;
+}
+
+void EntityManager::removeFromGroup(uint32_t index, size_t family)
+{
+	if (family >= m_componentGroups.size() || m_componentGroups[family] == nullptr) {
+		return;
+	}
+
+	detail::OwningGroup* group = m_componentGroups[family];
+	if ((m_entityComponentMasks[index] & group->mask) != group->mask) {
+		return;
+	}
+
+	// entity is swapped with the last element of group in each pool
+	--group->size;
+	for (size_t owned : group->families) {
+		BasePool* pool = m_componentPools[owned].get();
+		pool->swap(pool->find(index), group->size);
+	}
+}
+
+EntityId EntityManager::allocateEntity()
 {
 	uint32_t index, version;
 
@@ -45,12 +366,10 @@ std::shared_ptr<GameObject> EntityManager::create()
 			m_entityComponentMasks.resize(index + 1);
 			m_entityVersions.resize(index + 1);
 
-			m_gameObjects.resize(index + 1);
-
-			for (auto& pool : m_componentPools) {
-				if (pool) {
-					pool->expand(index + 1);
-				}
+			m_gameObjects.reserve(index + 1);
+			m_aliveEntities.resize(index / 64 + 1);
+			for (auto& bitmap : m_componentBitmaps) {
+				bitmap.resize(m_aliveEntities.size(), 0);
 			}
 		}
 		//
@@ -58,50 +377,154 @@ std::shared_ptr<GameObject> EntityManager::create()
 		version = m_entityVersions[index] = 1;
 	}
 	else {
+		std::pop_heap(m_availableIndices.begin(), m_availableIndices.end(), std::greater<uint32_t>());
 		index = m_availableIndices.back();
 		m_availableIndices.pop_back();
 		version = m_entityVersions[index];
 	}
 
-	std::shared_ptr<GameObject> gameObject = GameObject::create(this, EntityId(index, version));
-	m_gameObjects[index] = gameObject;
-	
-	emit<Events::OnEntityCreated>({ gameObject });
+	setAlive(index, true);
+	++m_hierarchyVersion;
 
-	return gameObject;
+	return EntityId(index, version);
 }
 
-void EntityManager::destroy(EntityId id)
+std::vector<EntityId> EntityManager::allocateEntities(size_t count)
 {
-	emit<Events::OnEntityDestroyed>({ get(id) });
+	size_t newCount = count - std::min(count, m_availableIndices.size());
+	size_t capacity = m_currentIndex + newCount;
 
-	uint32_t index = id.getIndex();
-	ComponentMask mask = m_entityComponentMasks[index];
-	for (size_t i = 0; i < m_componentHelpers.size(); ++i) {
-		auto& helper = m_componentHelpers[i];
-		if (helper != nullptr && mask.test(i)) {
-			helper->removeComponent(this, id);
-		}
+	m_entityComponentMasks.reserve(capacity);
+	m_entityVersions.reserve(capacity);
+	m_gameObjects.reserve(capacity);
+
+	std::vector<EntityId> entities(count);
+	for (size_t i = 0; i < count; ++i) {
+		entities[i] = allocateEntity();
+		m_gameObjects.construct(this, entities[i]);
 	}
 
-	m_entityComponentMasks[index].reset();
-	m_entityVersions[index]++;
-	m_availableIndices.push_back(index);
+	return entities;
 }
 
-std::shared_ptr<GameObject> EntityManager::get(EntityId id)
+uint32_t EntityManager::getChangeVersion() const
+{
+	return m_changeVersion;
+}
+
+uint32_t EntityManager::getHierarchyVersion() const
 {
-	if (id.getIndex() < m_gameObjects.size()) {
-		return m_gameObjects[id.getIndex()];
+	return m_hierarchyVersion;
+}
+
+EntityManager::ComponentMask EntityManager::getComponentMask(EntityId id)
+{
+	return m_entityComponentMasks.at(id.getIndex());
+}
+
+void EntityManager::registerQuery(const ComponentMask & mask)
+{
+	if (mask.none() || findQuery(mask) != nullptr) {
+		return;
+	}
+
+	auto query = std::make_unique<detail::CachedQuery>(mask);
+
+	const std::vector<uint32_t>* candidates = getCandidates(mask);
+
+	Bitmaps bitmaps;
+	chooseBitmaps(mask, candidates->size(), bitmaps);
+	if (!bitmaps.empty()) {
+		const uint32_t capacity = static_cast<uint32_t>(getCapacity());
+		for (uint32_t index = findMatchingEntity(0, bitmaps); index < capacity; index = findMatchingEntity(index + 1, bitmaps)) {
+			query->insert(index);
+		}
 	}
 	else {
-		return nullptr;
+		for (uint32_t index : *candidates) {
+			if ((m_entityComponentMasks[index] & mask) == mask) {
+				query->insert(index);
+			}
+		}
 	}
+
+	forEachComponent(mask, [this, &query](size_t family) {
+		if (m_componentQueries.size() <= family) {
+			m_componentQueries.resize(family + 1);
+		}
+		m_componentQueries[family].push_back(query.get());
+	});
+
+	m_queries.push_back(std::move(query));
 }
 
-EntityManager::ComponentMask EntityManager::getComponentMask(EntityId id)
+void EntityManager::unregisterQuery(const ComponentMask & mask)
 {
-	return m_entityComponentMasks.at(id.getIndex());
+	const detail::CachedQuery* query = findQuery(mask);
+	if (query == nullptr) {
+		return;
+	}
+
+	forEachComponent(mask, [this, query](size_t family) {
+		auto& queries = m_componentQueries[family];
+		queries.erase(std::remove(queries.begin(), queries.end(), query), queries.end());
+	});
+
+	m_queries.erase(std::remove_if(m_queries.begin(), m_queries.end(), 
+		[query](const std::unique_ptr<detail::CachedQuery>& item) { return item.get() == query; }), m_queries.end());
+}
+
+void EntityManager::group(const ComponentMask & mask)
+{
+	auto group = std::make_unique<detail::OwningGroup>();
+	group->mask = mask;
+	group->size = 0;
+
+	forEachComponent(mask, [this, &group](size_t family) {
+		if (family >= m_componentPools.size() || m_componentPools[family] == nullptr) {
+			throw std::runtime_error("Unable to create group. Component has no pool");
+		}
+
+		if (family < m_componentGroups.size() && m_componentGroups[family] != nullptr) {
+			throw std::runtime_error("Unable to create group. Component is already owned by another group");
+		}
+
+		group->families.push_back(family);
+	});
+
+	if (group->families.empty()) {
+		return;
+	}
+
+	// grouped components are walked chunk by chunk in all pools at once
+	for (size_t family : group->families) {
+		if (m_componentPools[family]->getChunkSize() != m_componentPools[group->families.front()]->getChunkSize()) {
+			throw std::runtime_error("Unable to create group. Pools have different chunk sizes");
+		}
+	}
+
+	for (size_t family : group->families) {
+		if (m_componentGroups.size() <= family) {
+			m_componentGroups.resize(family + 1, nullptr);
+		}
+		m_componentGroups[family] = group.get();
+	}
+
+	// entities are collected first, because adding them moves pool elements
+	const BasePool* smallest = m_componentPools[group->families.front()].get();
+	for (size_t family : group->families) {
+		if (m_componentPools[family]->getSize() < smallest->getSize()) {
+			smallest = m_componentPools[family].get();
+		}
+	}
+
+	const std::vector<uint32_t> entities = smallest->getEntityIndices();
+	detail::OwningGroup* owningGroup = group.get();
+	m_groups.push_back(std::move(group));
+
+	for (uint32_t index : entities) {
+		addToGroup(index, owningGroup->families.front());
+	}
 }
 
 void EntityManager::registerSystem(std::shared_ptr<EntitySystem> system)
@@ -111,6 +534,7 @@ void EntityManager::registerSystem(std::shared_ptr<EntitySystem> system)
 	}
 
 	m_systems.push_back(system);
+	m_systemStagesChanged = true;
 	system->m_manager = this;
 	system->init();
 }
@@ -124,4 +548,149 @@ void EntityManager::unregisterSystem(std::shared_ptr<EntitySystem> system)
 	system->close();
 	system->m_manager = nullptr;
 	m_systems.erase(std::remove(m_systems.begin(), m_systems.end(), system), m_systems.end());
+	m_systemStagesChanged = true;
+}
+
+void EntityManager::update(const float dt)
+{
+	if (m_systemStagesChanged) {
+		// system goes to the stage after the last stage
+		// of earlier systems which it conflicts with
+		std::vector<size_t> systemStages(m_systems.size(), 0);
+		m_systemStages.clear();
+
+		for (size_t i = 0; i < m_systems.size(); ++i) {
+			size_t stage = 0;
+			for (size_t j = 0; j < i; ++j) {
+				if (m_systems[i]->conflictsWith(*m_systems[j])) {
+					stage = std::max(stage, systemStages[j] + 1);
+				}
+			}
+
+			systemStages[i] = stage;
+			if (m_systemStages.size() <= stage) {
+				m_systemStages.resize(stage + 1);
+			}
+			m_systemStages[stage].push_back(m_systems[i].get());
+		}
+
+		m_systemStagesChanged = false;
+	}
+
+	// system sees changes made after its previous update,
+	// including changes of its own command buffer records
+	auto updateSystem = [this, dt](EntitySystem* system) {
+		const uint32_t lastUpdateVersion = m_lastUpdateVersion;
+		m_lastUpdateVersion = system->m_changeVersion;
+
+		auto start = std::chrono::steady_clock::now();
+		system->update(dt);
+		system->m_updateTime = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+
+		system->m_changeVersion = m_changeVersion;
+		m_lastUpdateVersion = lastUpdateVersion;
+	};
+
+	for (auto& stage : m_systemStages) {
+		JobCounter counter;
+
+		for (auto* system : stage) {
+			if (!system->isMainThreadOnly() && stage.size() > 1) {
+				JobSystem::run([&updateSystem, system]() { updateSystem(system); }, &counter);
+			}
+		}
+
+		for (auto* system : stage) {
+			if (system->isMainThreadOnly() || stage.size() == 1) {
+				updateSystem(system);
+			}
+		}
+
+		JobSystem::wait(counter);
+
+		++m_changeVersion;
+
+		if (!m_commandBuffer->isEmpty()) {
+			m_commandBuffer->playback();
+		}
+	}
+
+	dispatchEvents();
+}
+
+void EntityManager::setEventMode(EventMode mode)
+{
+	m_eventMode = mode;
+}
+
+EntityManager::EventMode EntityManager::getEventMode() const
+{
+	return m_eventMode;
+}
+
+void EntityManager::dispatchEvents()
+{
+	// subscribers may emit new events, they are delivered in the same call
+	bool hasEvents = true;
+	while (hasEvents) {
+		hasEvents = false;
+
+		for (size_t family = 0; family < m_eventQueues.size(); ++family) {
+			auto& queue = m_eventQueues[family];
+			if (queue != nullptr && !queue->isEmpty()) {
+				// copy, because subscribers may subscribe during dispatch
+				const std::vector<detail::BaseEventSubscriber*> subscribers = m_subscribers[family];
+				queue->dispatch(this, subscribers);
+				hasEvents = true;
+			}
+		}
+	}
+}
+
+EntityCommandBuffer * EntityManager::getCommandBuffer()
+{
+	return m_commandBuffer.get();
+}
+
+void detail::CachedQuery::insert(uint32_t entityIndex)
+{
+	if (contains(entityIndex)) {
+		return;
+	}
+
+	if (entityIndex >= m_sparse.size()) {
+		m_sparse.resize(entityIndex + 1, BasePool::INVALID_INDEX);
+	}
+
+	m_sparse[entityIndex] = static_cast<uint32_t>(m_dense.size());
+	m_dense.push_back(entityIndex);
+}
+
+void detail::CachedQuery::erase(uint32_t entityIndex)
+{
+	if (!contains(entityIndex)) {
+		return;
+	}
+
+	uint32_t position = m_sparse[entityIndex];
+	uint32_t lastEntityIndex = m_dense.back();
+
+	m_dense[position] = lastEntityIndex;
+	m_sparse[lastEntityIndex] = position;
+
+	m_sparse[entityIndex] = BasePool::INVALID_INDEX;
+	m_dense.pop_back();
+}
+
+void detail::CachedQuery::sortByEntityIndex()
+{
+	std::sort(m_dense.begin(), m_dense.end());
+	for (size_t i = 0; i < m_dense.size(); ++i) {
+		m_sparse[m_dense[i]] = static_cast<uint32_t>(i);
+	}
+}
+
+bool detail::CachedQuery::contains(uint32_t entityIndex) const
+{
+	return entityIndex < m_sparse.size() && m_sparse[entityIndex] != BasePool::INVALID_INDEX;
 }
@@ -1,17 +1,31 @@
 #pragma once
 
+#include <unordered_map>
 #include <functional>
+#include <algorithm>
 #include <typeindex>
+#include <stdexcept>
+#include <atomic>
+#include <iterator>
+#include <cstring>
 #include <memory>
 #include <vector>
 #include <bitset>
+#include <tuple>
 
-#include "Pool.h"
+#include "GameObjectPool.h"
+#include "JobSystem.h"
+#include "SharedPool.h"
+#include "SoAPool.h"
 
-#define MAX_COMPONENTS 64
+// Number of component types, can be defined by project settings
+#ifndef MAX_COMPONENTS
+#define MAX_COMPONENTS 256
+#endif
 
 class GameObject;
 class EntityManager;
+class EntityCommandBuffer;
 
 
 class EntityId
@@ -52,14 +66,123 @@ private:
 };
 
 
+// Query filter, matches components which were changed since the previous
+// update of the system which iterates. Outside of systems all components
+// which were ever changed match
+template<typename T>
+struct Changed {};
+
+// Query filter, matches components which were assigned since the previous
+// update of the system which iterates
+template<typename T>
+struct Added {};
+
+
 namespace detail
 {
+	enum QueryFilter
+	{
+		NO_FILTER,
+		CHANGED_FILTER,
+		ADDED_FILTER
+	};
+
+	template<typename T>
+	struct QueryTraits
+	{
+		typedef T Component;
+		static const QueryFilter filter = NO_FILTER;
+	};
+
+	template<typename T>
+	struct QueryTraits<Changed<T>>
+	{
+		typedef T Component;
+		static const QueryFilter filter = CHANGED_FILTER;
+	};
+
+	template<typename T>
+	struct QueryTraits<Added<T>>
+	{
+		typedef T Component;
+		static const QueryFilter filter = ADDED_FILTER;
+	};
+
+	inline uint32_t getVersion(const BasePool& pool, QueryFilter filter, size_t n)
+	{
+		return filter == ADDED_FILTER ? pool.getAddVersion(n) : pool.getChangeVersion(n);
+	}
+
+	inline uint32_t getChunkVersion(const BasePool& pool, QueryFilter filter, size_t chunk)
+	{
+		return filter == ADDED_FILTER ? pool.getChunkAddVersion(chunk) : pool.getChunkChangeVersion(chunk);
+	}
+
+	// Version filters of view
+	// Candidates of view are taken from the first pool, so its unchanged
+	// chunks are skipped without checking entities
+	struct ChangeFilters
+	{
+		bool matches(uint32_t entityIndex) const
+		{
+			for (size_t i = 0; i < pools.size(); ++i) {
+				const uint32_t position = pools[i]->find(entityIndex);
+				if (position == BasePool::INVALID_INDEX || getVersion(*pools[i], filters[i], position) <= since) {
+					return false;
+				}
+			}
+			return true;
+		}
+
+		std::vector<const BasePool*> pools;
+		std::vector<QueryFilter> filters;
+		uint32_t since;
+	};
+
+
 	class BaseEventSubscriber
 	{
 	public:
 		virtual ~BaseEventSubscriber() {}
 	};
 
+	class BaseEvent
+	{
+	protected:
+		static std::atomic<size_t> m_familyCounter;
+	};
+
+	// Sequential id of event type, used as index in subscriber lists
+	// Counter is atomic because first use can happen in parallel systems
+	template<typename T>
+	class Event : public BaseEvent
+	{
+	public:
+		static size_t getFamily()
+		{
+			static size_t family = m_familyCounter++;
+			return family;
+		}
+	};
+
+	class BaseEventQueue
+	{
+	public:
+		virtual ~BaseEventQueue() {}
+		virtual void dispatch(EntityManager* manager, const std::vector<BaseEventSubscriber*>& subscribers) = 0;
+		virtual bool isEmpty() const = 0;
+	};
+
+	template<typename T>
+	class EventQueue : public BaseEventQueue
+	{
+	public:
+		void dispatch(EntityManager* manager, const std::vector<BaseEventSubscriber*>& subscribers) override;
+		bool isEmpty() const override { return m_events.empty(); }
+
+		std::vector<T> m_events;
+	};
+
 	class BaseComponent
 	{
 	public:
@@ -73,15 +196,59 @@ namespace detail
 			throw std::bad_alloc();
 		}
 
-		static size_t m_familyCounter;
+		static std::atomic<size_t> m_familyCounter;
+	};
+
+	// Copies of components of one type taken from several entities
+	// Each copy belongs to node of some tree, so the same copies can be
+	// assigned to many instances of this tree at once
+	class BaseComponentList
+	{
+	public:
+		virtual ~BaseComponentList() {}
+
+		virtual void push(EntityManager* manager, EntityId source, uint32_t node) = 0;
+
+		// Assigns copy of each node to entities[instance * nodeCount + node]
+		// of all instances
+		virtual void assignTo(EntityManager* manager, const std::vector<EntityId>& entities, size_t nodeCount) const = 0;
+	};
+
+	template<typename T>
+	class ComponentList : public BaseComponentList
+	{
+	public:
+		void push(EntityManager* manager, EntityId source, uint32_t node) override;
+		void assignTo(EntityManager* manager, const std::vector<EntityId>& entities, size_t nodeCount) const override;
+
+	private:
+		std::vector<T> m_values;
+		std::vector<uint32_t> m_nodes;
 	};
 
+	// Shared components keep their values, so copies don't depend on sources
+	template<typename T>
+	class ComponentList<Shared<T>> : public BaseComponentList
+	{
+	public:
+		void push(EntityManager* manager, EntityId source, uint32_t node) override;
+		void assignTo(EntityManager* manager, const std::vector<EntityId>& entities, size_t nodeCount) const override;
+
+	private:
+		std::vector<T> m_values;
+		std::vector<uint32_t> m_nodes;
+	};
+
+	template<typename T>
+	class TypedComponentCommand;
+
 	class BaseComponentHelper
 	{
 	public:
 		virtual ~BaseComponentHelper() {}
 		virtual void removeComponent(EntityManager* manager, EntityId id) = 0;
 		virtual void copyComponentTo(EntityManager* manager, EntityId source, EntityId target) = 0;
+		virtual std::unique_ptr<BaseComponentList> createList() const = 0;
 	};
 
 	template<typename T>
@@ -90,6 +257,39 @@ namespace detail
 	public:
 		void removeComponent(EntityManager* manager, EntityId id) override;
 		void copyComponentTo(EntityManager* manager, EntityId source, EntityId target) override;
+		std::unique_ptr<BaseComponentList> createList() const override;
+	};
+
+	// Components which are owned by group and the number of entities
+	// at the front of their pools which have all of them
+	struct OwningGroup
+	{
+		std::bitset<MAX_COMPONENTS> mask;
+		std::vector<size_t> families;
+		size_t size;
+	};
+
+	// Sparse set of entities which have all components from mask
+	class CachedQuery
+	{
+	public:
+		CachedQuery(const std::bitset<MAX_COMPONENTS>& mask) : 
+			m_mask(mask)
+		{}
+
+		void insert(uint32_t entityIndex);
+		void erase(uint32_t entityIndex);
+		bool contains(uint32_t entityIndex) const;
+
+		void sortByEntityIndex();
+
+		const std::bitset<MAX_COMPONENTS>& getMask() const { return m_mask; }
+		const std::vector<uint32_t>& getEntityIndices() const { return m_dense; }
+
+	private:
+		std::bitset<MAX_COMPONENTS> m_mask;
+		std::vector<uint32_t> m_sparse;
+		std::vector<uint32_t> m_dense;
 	};
 }
 
@@ -113,6 +313,11 @@ public:
 	T* get();
 	const T* get() const;
 
+	// Copies component out of pool and back, works with SoA components
+	// which can't be accessed by pointer. Load throws if handle is invalid
+	T load() const;
+	void store(const T& value);
+
 	operator bool() const
 	{
 		return isValid();
@@ -120,12 +325,12 @@ public:
 
 	bool operator==(const ComponentHandle<T> &other) const 
 	{
-		return m_manager == other.m_manager && m_id == other.m_id;
+		return m_manager == other.m_manager && m_entityId == other.m_entityId;
 	}
 
 	bool operator!=(const ComponentHandle<T> &other) const 
 	{
-		return m_manager != other.m_manager || m_id != other.m_id;
+		return m_manager != other.m_manager || m_entityId != other.m_entityId;
 	}
 	
 private:
@@ -165,6 +370,14 @@ public:
 	virtual ~EventSubscriber() {}
 
 	virtual void onReceive(EntityManager* manager, const T& event) = 0;
+
+	// Is called with all queued events of this type at once
+	virtual void onReceiveBatch(EntityManager* manager, const std::vector<T>& events)
+	{
+		for (const auto& event : events) {
+			onReceive(manager, event);
+		}
+	}
 };
 
 
@@ -180,6 +393,16 @@ namespace Events
 		std::shared_ptr<GameObject> gameObject;
 	};
 
+	struct OnEntitiesCreated
+	{
+		std::vector<EntityId> entities;
+	};
+
+	struct OnEntitiesDestroyed
+	{
+		std::vector<EntityId> entities;
+	};
+
 	template<typename T>
 	struct OnComponentAssigned
 	{
@@ -193,13 +416,29 @@ namespace Events
 		std::shared_ptr<GameObject> gameObject;
 		ComponentHandle<T> handle;
 	};
+
+	template<typename T>
+	struct OnComponentsAssigned
+	{
+		std::vector<EntityId> entities;
+	};
+
+	// Emitted before components are removed
+	template<typename T>
+	struct OnComponentsRemoved
+	{
+		std::vector<EntityId> entities;
+	};
 }
 
 
 class EntitySystem
 {
 public:
-	EntitySystem() : m_manager(nullptr) {}
+	EntitySystem() : 
+		m_manager(nullptr), m_hasDeclaredAccess(false), m_isMainThreadOnly(false), 
+		m_changeVersion(0), m_updateTime(0.0f)
+	{}
 	virtual ~EntitySystem() {}
 
 	virtual void init() {}
@@ -208,10 +447,46 @@ public:
 
 	virtual void update(const float dt) {}
 
+	// Returns true if this system can't run concurrently with other
+	bool conflictsWith(const EntitySystem& other) const;
+
+	bool isMainThreadOnly() const { return m_isMainThreadOnly; }
+
+	// Returns duration of last update call in seconds
+	float getUpdateTime() const { return m_updateTime; }
+
 protected:
 	friend class EntityManager;
 
+	// Declares components which are only read in update
+	template<typename... Ts>
+	void reads();
+
+	// Declares components which are changed in update
+	template<typename... Ts>
+	void writes();
+
+	// Systems which use OpenGL or other thread bound resources
+	// are always updated on the thread which called EntityManager::update
+	void setMainThreadOnly(bool mainThreadOnly) { m_isMainThreadOnly = mainThreadOnly; }
+
+	// Declares that update uses results of another system, so they are
+	// never updated concurrently. Must be called before the first update
+	void dependsOn(const EntitySystem* system) { m_dependencies.push_back(system); }
+
 	EntityManager* m_manager;
+
+private:
+	std::bitset<MAX_COMPONENTS> m_readMask;
+	std::bitset<MAX_COMPONENTS> m_writeMask;
+	std::vector<const EntitySystem*> m_dependencies;
+	bool m_hasDeclaredAccess;
+	bool m_isMainThreadOnly;
+
+	// change version of the stage in which system was updated last time
+	uint32_t m_changeVersion;
+
+	float m_updateTime;
 };
 
 
@@ -221,65 +496,92 @@ public:
 	typedef std::bitset<MAX_COMPONENTS> ComponentMask;
 
 	EntityManager();
+	~EntityManager();
 
 	size_t getSize() const;
 	size_t getCapacity() const;
 
+	// Returns size of allocated chunks and size of components of all pools
+	size_t getCommittedBytes() const;
+	size_t getUsedBytes() const;
+
 	EntityId createId(uint32_t index) const;
 	bool isValid(EntityId id) const;
 
 	std::shared_ptr<GameObject> create();
 	void destroy(EntityId id);
 
-	std::shared_ptr<GameObject> get(EntityId id);
-
-	template<typename T, typename... Args>
-	ComponentHandle<T> assign(EntityId id, Args&&... args)
+	// Creates count entities with copies of specified components
+	// Emits single OnEntitiesCreated event instead of per entity
+	// and per component events
+	template<typename... Ts>
+	std::vector<EntityId> createMany(size_t count, const Ts&... components)
 	{
-		size_t family = getComponentFamily<T>();
-		
-		// accomodate component
-		while (m_componentPools.size() <= family) {
-			m_componentPools.emplace_back(nullptr);
+		std::vector<EntityId> entities = allocateEntities(count);
+		if (entities.empty()) {
+			return entities;
 		}
 
-		while (m_componentHelpers.size() <= family) {
-			m_componentHelpers.emplace_back(nullptr);
-		}
+		using dummy = int[];
+		(void)dummy {
+			0, (assignMany<Ts>(entities, components), 0)...
+		};
 
-		auto& pool = m_componentPools[family];
-		if (pool == nullptr) {
-			pool = std::move(std::make_unique<Pool<T>>());
-			pool->expand(m_currentIndex);
+		if (hasSubscribers<Events::OnEntitiesCreated>()) {
+			emit<Events::OnEntitiesCreated>({ entities });
 		}
+		return entities;
+	}
 
-		auto& helper = m_componentHelpers[family];
-		if (helper == nullptr) {
-			helper = std::move(std::make_unique<detail::ComponentHelper<T>>());
-		}
-		//
+	// Destroys all valid entities from list
+	// Emits single OnEntitiesDestroyed event before destruction instead of
+	// per entity and per component events
+	void destroyMany(const EntityId* entities, size_t count);
+	void destroyMany(const std::vector<EntityId>& entities);
 
-		new(pool->get(id.getIndex())) T(std::forward<Args>(args)...);
-		
-		m_entityComponentMasks[id.getIndex()].set(family);
-		ComponentHandle<T> component(this, id);
-		emit<Events::OnComponentAssigned<T>>({ get(id), component });
+	// Returned pointer shares ownership of object. After entity is destroyed
+	// object stays alive, but it is invalidated when entity index is reused
+	// Only the first call for object takes a lock, but per frame code
+	// should use getObject
+	std::shared_ptr<GameObject> get(EntityId id);
+
+	// Same as get but without shared pointer, for hot loops
+	// Pointer is valid until entity index is reused
+	GameObject* getObject(EntityId id) const;
+
+	// Returns some game object with specified name or nullptr
+	GameObject* findByName(StringId name) const;
+
+	// Sorts components of pools and cached queries by entity index
+	// Entities with several components are then visited in the same order
+	// in all pools. Entity ids and component handles stay valid
+	// At most maxPools unsorted pools are sorted per call, so compaction
+	// can be spread over several frames. Returns true when all pools are sorted
+	// Pools owned by groups keep order of their group
+	bool compact(size_t maxPools = ~size_t(0));
+
+	template<typename T, typename... Args>
+	ComponentHandle<T> assign(EntityId id, Args&&... args)
+	{
+		ComponentHandle<T> component = emplaceComponent<T>(id, std::forward<Args>(args)...);
+		if (hasSubscribers<Events::OnComponentAssigned<T>>()) {
+			emit<Events::OnComponentAssigned<T>>({ get(id), component });
+		}
 		return component;
 	}
 
 	template<typename T>
 	void remove(EntityId id)
 	{
-		size_t family = getComponentFamily<T>();
-		uint32_t index = id.getIndex();
-
-		ComponentHandle<T> component(this, id);
-		emit<Events::OnComponentRemoved<T>>({ get(id), component });
+		if (!hasComponent<T>(id)) {
+			return;
+		}
 
-		m_entityComponentMasks[index].reset(family);
+		if (hasSubscribers<Events::OnComponentRemoved<T>>()) {
+			emit<Events::OnComponentRemoved<T>>({ get(id), ComponentHandle<T>(this, id) });
+		}
 
-		auto& pool = m_componentPools[family];
-		pool->destroy(index);
+		eraseComponent<T>(id);
 	}
 
 	template<typename T>
@@ -292,7 +594,9 @@ public:
 		}
 
 		auto& pool = m_componentPools[family];
-		if (pool == nullptr || !m_entityComponentMasks[id.getIndex()][family]) {
+		if (pool == nullptr || id.getIndex() >= m_entityComponentMasks.size() ||
+			!m_entityComponentMasks[id.getIndex()][family])
+		{
 			return false;
 		}
 
@@ -309,7 +613,9 @@ public:
 		}
 
 		auto& pool = m_componentPools[family];
-		if (pool == nullptr || !m_entityComponentMasks[id.getIndex()][family]) {
+		if (pool == nullptr || id.getIndex() >= m_entityComponentMasks.size() ||
+			!m_entityComponentMasks[id.getIndex()][family])
+		{
 			return ComponentHandle<T>();
 		}
 
@@ -326,7 +632,9 @@ public:
 		}
 
 		auto& pool = m_componentPools[family];
-		if (pool == nullptr || !m_entityComponentMasks[id.getIndex()][family]) {
+		if (pool == nullptr || id.getIndex() >= m_entityComponentMasks.size() ||
+			!m_entityComponentMasks[id.getIndex()][family])
+		{
 			return ComponentHandle<T>();
 		}
 
@@ -348,24 +656,46 @@ public:
 	template<typename T>
 	void unpack(EntityId id, ComponentHandle<T>& c)
 	{
-		c = getComponent<T>();
+		c = getComponent<T>(id);
 	}
 
 	template<typename T, typename... Ts>
 	void unpack(EntityId id, ComponentHandle<T>& c, ComponentHandle<Ts>&... cs)
 	{
-		c = getComponent<T>();
+		c = getComponent<T>(id);
 		unpack<Ts...>(id, cs...);
 	}
 
+	// Query filters like Changed<T> have the family of their component
 	template<typename T>
 	static size_t getComponentFamily()
 	{
-		return detail::Component<typename std::remove_const<T>::type>::getFamily();
+		return detail::Component<typename std::remove_const<typename detail::QueryTraits<T>::Component>::type>::getFamily();
 	}
 
+	// Returns version which is written to changed and added components now
+	// It is incremented after each stage of system update
+	uint32_t getChangeVersion() const;
+
+	// Returns version which is incremented whenever entity is created or
+	// destroyed or game object gets another parent
+	uint32_t getHierarchyVersion() const;
+
 	ComponentMask getComponentMask(EntityId id);
 
+	// Calls func(family) for each component family set in mask
+	template<typename Func>
+	static void forEachComponent(const ComponentMask& mask, Func&& func)
+	{
+		for (size_t offset = 0; offset < MAX_COMPONENTS; offset += 64) {
+			uint64_t word = ((mask >> offset) & ComponentMask(~0ULL)).to_ullong();
+			while (word != 0) {
+				func(offset + detail::countTrailingZeros(word));
+				word &= word - 1;
+			}
+		}
+	}
+
 	template<typename T>
 	ComponentMask getComponentMask() 
 	{
@@ -393,7 +723,13 @@ public:
 	}
 
 	// views and iterator helpers
+	typedef std::vector<const std::vector<uint64_t>*> Bitmaps;
 
+	// Iterates over entities which have all components from mask
+	// Entities are either candidates from the smallest matching pool or
+	// bits which are set in all bitmaps of components from mask, which are
+	// matched 64 entities at a time. In All mode alive bitmap is used
+	// Components must not be assigned or removed while iterating
 	template<class Delegate, bool All = false>
 	class ViewIterator : public std::iterator<std::input_iterator_tag, EntityId>
 	{
@@ -407,59 +743,86 @@ public:
 
 		bool operator==(const Delegate& rhs) const { return m_index == rhs.m_index; }
 		bool operator!=(const Delegate& rhs) const { return m_index != rhs.m_index; }
-		EntityId operator*() { return m_manager->createId(m_index); }
-		const EntityId operator*() const { return m_manager->createId(m_index); }
+		EntityId operator*() { return m_manager->createId(getEntityIndex()); }
+		const EntityId operator*() const { return m_manager->createId(getEntityIndex()); }
 
 	protected:
-		ViewIterator(EntityManager* manager, uint32_t index) :
-			m_manager(manager), m_index(index), m_capacity(m_manager->getCapacity()), m_freeCursor(~0UL)
+		ViewIterator(EntityManager* manager, const std::vector<uint32_t>* candidates, uint32_t index) :
+			m_manager(manager), m_candidates(candidates), m_filters(nullptr), m_index(index)
 		{
-			if (All) {
-				std::sort(m_manager->m_availableIndices.begin(), m_manager->m_availableIndices.end());
-				m_freeCursor = 0;
-			}
+			init();
 		}
 
-		ViewIterator(EntityManager* manager, const ComponentMask& mask, uint32_t index) :
-			m_manager(manager), m_mask(mask), m_index(index), m_capacity(m_manager->getCapacity()), m_freeCursor(~0UL)
+		ViewIterator(EntityManager* manager, const ComponentMask& mask, const std::vector<uint32_t>* candidates, uint32_t index, 
+			const detail::ChangeFilters* filters = nullptr, const Bitmaps* bitmaps = nullptr) :
+			m_manager(manager), m_mask(mask), m_candidates(candidates), m_filters(filters), m_bitmaps(bitmaps), m_index(index)
 		{
-			if (All) {
-				std::sort(m_manager->m_availableIndices.begin(), m_manager->m_availableIndices.end());
-				m_freeCursor = 0;
+			init();
+		}
+
+		void init()
+		{
+			if (m_bitmaps != nullptr) {
+				m_size = m_manager->getCapacity();
+			}
+			else {
+				m_size = m_candidates->size();
 			}
 		}
 
 		void next()
 		{
-			while (m_index < m_capacity && !predicate()) {
+			if (m_bitmaps != nullptr) {
+				m_index = m_manager->findMatchingEntity(m_index, *m_bitmaps);
+			}
+
+			skipUnchangedChunks();
+			while (m_index < m_size && !predicate()) {
 				++m_index;
+				skipUnchangedChunks();
 			}
 
-			if (m_index < m_capacity) {
-				static_cast<Delegate*>(this)->nextEntity(m_manager->createId(m_index));
+			if (m_index < m_size) {
+				static_cast<Delegate*>(this)->nextEntity(m_manager->createId(getEntityIndex()));
 			}
 		}
 
+		inline uint32_t getEntityIndex() const
+		{
+			return m_bitmaps != nullptr ? m_index : (*m_candidates)[m_index];
+		}
+
 		inline bool predicate() {
-			return (All && isEntityValid()) ||
-				(m_manager->m_entityComponentMasks[m_index] & m_mask) == m_mask;
+			return m_bitmaps != nullptr ||
+				((m_manager->m_entityComponentMasks[getEntityIndex()] & m_mask) == m_mask &&
+				(m_filters == nullptr || m_filters->matches(getEntityIndex())));
 		}
 
-		inline bool isEntityValid() {
-			const std::vector<uint32_t>& availableIndices = m_manager->m_availableIndices;
-			if (m_freeCursor < availableIndices.size() && availableIndices[m_freeCursor] == m_index) {
-				++m_freeCursor;
-				return false;
+		void skipUnchangedChunks()
+		{
+			if (m_filters == nullptr) {
+				return;
+			}
+
+			// chunk of current index is checked wherever index is inside it,
+			// so chunk is skipped even if its first entity didn't match
+			const BasePool* pool = m_filters->pools.front();
+			const size_t chunkSize = pool->getChunkSize();
+			while (m_index < m_size &&
+				detail::getChunkVersion(*pool, m_filters->filters.front(), m_index / chunkSize) <= m_filters->since)
+			{
+				m_index = static_cast<uint32_t>(std::min(m_size, (m_index / chunkSize + 1) * chunkSize));
 			}
-			return true;
 		}
 
 		EntityManager* m_manager;
 		ComponentMask m_mask;
+		const std::vector<uint32_t>* m_candidates;
+		const detail::ChangeFilters* m_filters;
+		const Bitmaps* m_bitmaps;
 
 		uint32_t m_index;
-		size_t m_capacity;
-		size_t m_freeCursor;
+		size_t m_size;
 	};
 
 	template<bool All>
@@ -469,8 +832,9 @@ public:
 		class Iterator : public ViewIterator<Iterator, All>
 		{
 		public:
-			Iterator(EntityManager* manager, const ComponentMask& mask, uint32_t index) :
-				ViewIterator<Iterator, All>(manager, mask, index)
+			Iterator(EntityManager* manager, const ComponentMask& mask, const std::vector<uint32_t>* candidates, uint32_t index, 
+				const detail::ChangeFilters* filters, const Bitmaps* bitmaps) :
+				ViewIterator<Iterator, All>(manager, mask, candidates, index, filters, bitmaps)
 			{
 				ViewIterator<Iterator, All>::next();
 			}
@@ -478,39 +842,80 @@ public:
 			void nextEntity(EntityId entity) {}
 		};
 
-		Iterator begin() { return Iterator(m_manager, m_mask, 0); }
-		Iterator end() { return Iterator(m_manager, m_mask, uint32_t(m_manager->getCapacity())); }
-		const Iterator begin() const { return Iterator(m_manager, m_mask, 0); }
-		const Iterator end() const { return Iterator(m_manager, m_mask, uint32_t(m_manager->getCapacity())); }
+		Iterator begin() { return Iterator(m_manager, m_mask, m_candidates, 0, getFilters(), getBitmaps()); }
+		Iterator end() { return Iterator(m_manager, m_mask, m_candidates, getEndIndex(), getFilters(), getBitmaps()); }
+		const Iterator begin() const { return Iterator(m_manager, m_mask, m_candidates, 0, getFilters(), getBitmaps()); }
+		const Iterator end() const { return Iterator(m_manager, m_mask, m_candidates, getEndIndex(), getFilters(), getBitmaps()); }
 
 	protected:
 		friend class EntityManager;
 
 		BaseView(EntityManager* manager) :
-			m_manager(manager)
+			m_manager(manager), m_candidates(nullptr)
 		{
 			m_mask.set();
+			m_bitmaps.push_back(&manager->m_aliveEntities);
 		}
 
 		BaseView(EntityManager* manager, const ComponentMask& mask) :
-			m_manager(manager), m_mask(mask)
-		{}
+			m_manager(manager), m_mask(mask), 
+			m_candidates(All ? nullptr : manager->getCandidates(mask))
+		{
+			if (All) {
+				m_bitmaps.push_back(&manager->m_aliveEntities);
+			}
+			else {
+				manager->chooseBitmaps(mask, m_candidates->size(), m_bitmaps);
+			}
+		}
+
+		uint32_t getEndIndex() const
+		{
+			return static_cast<uint32_t>(m_bitmaps.empty() ? m_candidates->size() : m_manager->getCapacity());
+		}
+
+		const detail::ChangeFilters* getFilters() const
+		{
+			return m_filters.pools.empty() ? nullptr : &m_filters;
+		}
+
+		const Bitmaps* getBitmaps() const
+		{
+			return m_bitmaps.empty() ? nullptr : &m_bitmaps;
+		}
 
 		EntityManager* m_manager;
 		ComponentMask m_mask;
+		const std::vector<uint32_t>* m_candidates;
+		detail::ChangeFilters m_filters;
+		Bitmaps m_bitmaps;
 	};
 
 	template<bool All, typename... Ts>
 	class TypedView : public BaseView<All>
 	{
 	public:
-		void each(typename std::common_type<std::function<void(EntityId, Ts&...)>>::type func)
+		// Calls func(EntityId, Ts&...) for each entity of this view
+		template<typename Func>
+		void each(Func&& func)
 		{
-			for (auto it : *this) {
-				func(it, *(BaseView<All>::m_manager->template getComponent<Ts>(it).get())...);
+			if constexpr (sizeof...(Ts) == 0) {
+				// view of all entities
+				BaseView<All>::m_manager->template each<>(std::forward<Func>(func));
+			}
+			else {
+				BaseView<All>::m_manager->template eachInView<Ts...>(func, BaseView<All>::begin(), BaseView<All>::end(),
+					std::index_sequence_for<Ts...>{});
 			}
 		}
 
+		template<typename Func>
+		void eachStream(Func&& func)
+		{
+			static_assert(sizeof...(Ts) == 1, "Streams can be iterated only for single SoA component");
+			BaseView<All>::m_manager->template eachStream<Ts...>(std::forward<Func>(func));
+		}
+
 	private:
 		friend class EntityManager;
 
@@ -520,7 +925,14 @@ public:
 
 		TypedView(EntityManager* manager, const ComponentMask& mask) :
 			BaseView<All>(manager, mask)
-		{}
+		{
+			manager->template initFilters<Ts...>(BaseView<All>::m_filters, BaseView<All>::m_candidates);
+
+			// filtered views iterate over candidates to skip unchanged chunks
+			if (BaseView<All>::getFilters() != nullptr) {
+				BaseView<All>::m_bitmaps.clear();
+			}
+		}
 	};
 
 	template <typename... Ts>
@@ -532,8 +944,9 @@ public:
 	public:
 		class Unpacker
 		{
+		public:
 			Unpacker(EntityManager* manager, ComponentHandle<Ts>&... handles) :
-				m_handles(std::tuple<ComponentHandle<Ts>&...>(handles))
+				m_handles(std::tuple<ComponentHandle<Ts>&...>(handles...)), m_manager(manager)
 			{}
 
 			void unpack(EntityId entity) const
@@ -547,22 +960,22 @@ public:
 				std::get<N>(m_handles) = m_manager->getComponent<T>(entity);
 			}
 
-			template<int N, typename T1, typename T2, typename... Ts>
+			template<int N, typename T1, typename T2, typename... Rest>
 			void unpack(EntityId entity) const
 			{
 				std::get<N>(m_handles) = m_manager->getComponent<T1>(entity);
-				unpack<N + 1, T2, Ts...>(entity);
+				unpack<N + 1, T2, Rest...>(entity);
 			}
 
 			std::tuple<ComponentHandle<Ts>&...> m_handles;
 			EntityManager* m_manager;
 		};
 
-		class Iterator : ViewIterator<Iterator>
+		class Iterator : public ViewIterator<Iterator>
 		{
 		public:
-			Iterator(EntityManager* manager, const ComponentMask& mask, uint32_t index, const Unpacker& unpacker) :
-				ViewIterator<Iterator>(manager, mask, index), m_unpacker(unpacker)
+			Iterator(EntityManager* manager, const ComponentMask& mask, const std::vector<uint32_t>* candidates, uint32_t index, const Unpacker& unpacker) :
+				ViewIterator<Iterator>(manager, mask, candidates, index), m_unpacker(unpacker)
 			{
 				ViewIterator<Iterator>::next();
 			}
@@ -578,121 +991,876 @@ public:
 
 		Iterator begin()
 		{
-			return Iterator(m_manager, m_mask, 0, m_unpacker);
+			return Iterator(m_manager, m_mask, m_candidates, 0, m_unpacker);
 		}
 
 		Iterator end()
 		{
-			return Iterator(m_manager, m_mask, static_cast<uint32_t>(manager_->capacity()), m_unpacker);
+			return Iterator(m_manager, m_mask, m_candidates, static_cast<uint32_t>(m_candidates->size()), m_unpacker);
 		}
 
 		const Iterator begin() const
 		{
-			return Iterator(m_manager, m_mask, 0, m_unpacker);
+			return Iterator(m_manager, m_mask, m_candidates, 0, m_unpacker);
 		}
 
 		const Iterator end() const
 		{
-			return Iterator(m_manager, m_mask, static_cast<uint32_t>(m_manager->getCapacity()), m_unpacker);
+			return Iterator(m_manager, m_mask, m_candidates, static_cast<uint32_t>(m_candidates->size()), m_unpacker);
 		}
 
 	private:
 		friend class EntityManager;
 
 		UnpackingView(EntityManager* manager, const ComponentMask& mask, ComponentHandle<Ts>&... handles) :
-			m_manager(manager), m_mask(mask), m_unpacker(m_manager, handles...)
+			m_manager(manager), m_mask(mask), m_candidates(manager->getCandidates(mask)), m_unpacker(manager, handles...)
 		{}
 
 		EntityManager* m_manager;
 		ComponentMask m_mask;
+		const std::vector<uint32_t>* m_candidates;
 		Unpacker m_unpacker;
 	};
 
 	// iteration functions
-	template<typename... Ts>
-	View<Ts...> getEntitiesWithComponents()
-	{
-		ComponentMask mask = getComponentMask<Ts...>();
-		return View<Ts...>(this, mask);
-	}
 
-	template<typename... Ts>
-	void each(typename std::common_type<std::function<void(EntityId, Ts&...)>>::type func)
+	// Iterates over all created entities
+	TypedView<true> getEntities()
 	{
-		getEntitiesWithComponents<Ts...>().each(func);
+		return TypedView<true>(this);
 	}
 
 	template<typename... Ts>
-	UnpackingView<Ts...> getEntitiesWithComponents(ComponentHandle<Ts>&... cs)
+	View<Ts...> getEntitiesWithComponents()
 	{
 		ComponentMask mask = getComponentMask<Ts...>();
-		return UnpackingView<Ts...>(this, mask, cs...);
+		return View<Ts...>(this, mask);
 	}
 
-	// systems
-	void registerSystem(std::shared_ptr<EntitySystem> system);
-	void unregisterSystem(std::shared_ptr<EntitySystem> system);
-
-	// events
-	template<typename T>
-	void emit(const T& event)
+	// Calls func(EntityId, Ts&...) for each entity which has all specified components
+	// Pools are resolved once per call, components are passed by reference
+	// Components must not be assigned or removed while iterating
+	// Non const components are marked as changed, Changed<T> and Added<T>
+	// pass T& only for components which match the filter
+	// Without components func(EntityId) is called for each created entity
+	template<typename... Ts, typename Func>
+	void each(Func&& func)
 	{
-		auto index = std::type_index(typeid(T));
-		auto it = m_subscribers.find(index);
-		if (it != m_subscribers.end())
-		{
-			for (auto* subscriber : it->second)
-			{
-				reinterpret_cast<EventSubscriber<T>*>(subscriber)->onReceive(this, event);
+		if constexpr (sizeof...(Ts) == 0) {
+			eachAlive(func, 0, m_aliveEntities.size());
+		}
+		else {
+			const detail::OwningGroup* group = findGroup<Ts...>();
+			if (group != nullptr) {
+				eachGrouped<Ts...>(func, 0, group->size, m_lastUpdateVersion, std::index_sequence_for<Ts...>{});
+				return;
+			}
+
+			const BasePool* driver = getDrivingPool<Ts...>();
+			if (driver != nullptr) {
+				const std::vector<uint32_t>& entities = getDrivingEntities<Ts...>(driver);
+				eachInRange<Ts...>(func, driver, entities, 0, entities.size(), m_lastUpdateVersion);
 			}
 		}
 	}
 
-	template<typename T>
-	void subscribe(EventSubscriber<T>* subscriber)
+	// Same as each, but entities are split into ranges aligned to pool chunks
+	// which are processed concurrently by JobSystem workers
+	// Callback may read and write only the components passed to it and must
+	// not create or destroy entities, assign or remove components, emit events
+	// or change GameObject hierarchy. Everything else it touches must be
+	// synchronized by the caller
+	template<typename... Ts, typename Func>
+	void parallelEach(Func&& func)
 	{
-		auto index = std::type_index(typeid(T));
-		auto it = m_subscribers.find(index);
-		if (it == m_subscribers.end()) {
-			std::vector<detail::BaseEventSubscriber*> subscribers{ subscriber };
-			m_subscribers.insert({index, subscribers });
+		if constexpr (sizeof...(Ts) == 0) {
+			// ranges of 64 bitmap words, 4096 entities each
+			JobSystem::parallelFor(m_aliveEntities.size(), 64, [this, &func](size_t begin, size_t end) {
+				eachAlive(func, begin, end);
+			});
 		}
 		else {
-			it->second.push_back(subscriber);
-		}
-	}
+			const detail::OwningGroup* group = findGroup<Ts...>();
+			if (group != nullptr) {
+				const uint32_t since = m_lastUpdateVersion;
+				JobSystem::parallelFor(group->size, m_componentPools[group->families.front()]->getChunkSize(), 
+					[this, &func, since](size_t begin, size_t end) {
+						eachGrouped<Ts...>(func, begin, end, since, std::index_sequence_for<Ts...>{});
+					});
+				return;
+			}
 
-	template<typename T>
-	void unsubscribe(EventSubscriber<T>* subscriber)
-	{
-		auto index = std::type_index(typeid(T));
-		auto it = m_subscribers.find(index);
-		if (it != m_subscribers.end()) {
-			it->second.erase(std::remove(it->second.begin(), it->second.end(), subscriber), it->second.end());
-			if (it->second.empty()) {
-				m_subscribers.erase(it);
+			const BasePool* driver = getDrivingPool<Ts...>();
+			if (driver == nullptr) {
+				return;
 			}
+
+			const std::vector<uint32_t>& entities = getDrivingEntities<Ts...>(driver);
+			const uint32_t since = m_lastUpdateVersion;
+			JobSystem::parallelFor(entities.size(), driver->getChunkSize(), 
+				[this, &func, driver, &entities, since](size_t begin, size_t end) {
+					eachInRange<Ts...>(func, driver, entities, begin, end, since);
+				});
 		}
 	}
 
-private:
-	template<typename T>
-	friend class ComponentHandle;
-
-	template<typename T>
-	T* getComponentPtr(EntityId id)
+	// Calls func(const uint32_t* entityIndices, size_t count, Fields*... streams)
+	// for each chunk of SoA component pool. Streams contain count values
+	// of each field declared in SoALayout, in the same order
+	// Streams of non const component are marked as changed. Changed<T> and
+	// Added<T> skip whole chunks without matching components, but the rest
+	// of chunk is passed as is
+	template<typename Q, typename Func>
+	void eachStream(Func&& func)
 	{
-		BasePool* pool = m_componentPools[getComponentFamily<T>()].get();
-		return reinterpret_cast<T*>(pool->get(id.getIndex()));
+		auto* pool = getPool<Q>();
+		if (pool != nullptr) {
+			eachStreamInRange<Q>(func, 0, pool->getSize(), m_lastUpdateVersion);
+		}
+	}
+
+	// Same as eachStream, but chunks are processed concurrently by JobSystem
+	// workers. Callback has the same restrictions as in parallelEach
+	template<typename Q, typename Func>
+	void parallelEachStream(Func&& func)
+	{
+		auto* pool = getPool<Q>();
+		if (pool == nullptr) {
+			return;
+		}
+
+		const uint32_t since = m_lastUpdateVersion;
+		JobSystem::parallelFor(pool->getSize(), pool->getChunkSize(), 
+			[this, &func, since](size_t begin, size_t end) {
+				eachStreamInRange<Q>(func, begin, end, since);
+			});
+	}
+
+	// Calls func(const T& value, const std::vector<uint32_t>& entityIndices)
+	// for each distinct value of Shared<T> component. Entities which refer
+	// to the same value are passed together
+	template<typename T, typename Func>
+	void eachShared(Func&& func)
+	{
+		const SharedPool<T>* pool = getPool<Shared<T>>();
+		if (pool != nullptr) {
+			pool->eachValue(func);
+		}
+	}
+
+	template<typename... Ts>
+	UnpackingView<Ts...> getEntitiesWithComponents(ComponentHandle<Ts>&... cs)
+	{
+		ComponentMask mask = getComponentMask<Ts...>();
+		return UnpackingView<Ts...>(this, mask, cs...);
+	}
+
+	// Registers query which keeps list of entities with all specified components
+	// The list is updated when components are assigned or removed, so views
+	// and each with the same set of components visit only matching entities
+	template<typename... Ts>
+	void registerQuery()
+	{
+		registerQuery(getComponentMask<Ts...>());
+	}
+
+	void registerQuery(const ComponentMask& mask);
+
+	template<typename... Ts>
+	void unregisterQuery()
+	{
+		unregisterQuery(getComponentMask<Ts...>());
+	}
+
+	void unregisterQuery(const ComponentMask& mask);
+
+	// Declares owning group of specified components
+	// Entities which have all of them are kept at the front of their pools
+	// in the same order, so each with exactly these components walks pools
+	// in lock step without lookups. Component can be owned by one group,
+	// owned pools are not sorted by compact
+	template<typename... Ts>
+	void group()
+	{
+		using dummy = int[];
+		(void)dummy {
+			0, (accommodate<Ts>(), 0)...
+		};
+
+		group(getComponentMask<Ts...>());
+	}
+
+	void group(const ComponentMask& mask);
+
+	// systems
+	void registerSystem(std::shared_ptr<EntitySystem> system);
+	void unregisterSystem(std::shared_ptr<EntitySystem> system);
+
+	// Updates all registered systems
+	// Systems which don't conflict in declared component access are updated
+	// concurrently on JobSystem workers, others keep registration order.
+	// Concurrently updated systems must not change entity structure directly,
+	// they should record changes to command buffer which is played back
+	// after each group of concurrent systems
+	void update(const float dt);
+
+	EntityCommandBuffer* getCommandBuffer();
+
+	// events
+	enum EventMode
+	{
+		// events are delivered in emit call
+		IMMEDIATE,
+		// events are collected and delivered in dispatchEvents call
+		QUEUED
+	};
+
+	void setEventMode(EventMode mode);
+	EventMode getEventMode() const;
+
+	template<typename T>
+	bool hasSubscribers() const
+	{
+		size_t family = detail::Event<T>::getFamily();
+		return family < m_subscribers.size() && !m_subscribers[family].empty();
+	}
+
+	// Delivers event to subscribers or puts it to queue in QUEUED mode
+	// Does nothing if there are no subscribers of this event type
+	template<typename T>
+	void emit(const T& event)
+	{
+		if (!hasSubscribers<T>()) {
+			return;
+		}
+
+		if (m_eventMode == QUEUED) {
+			enqueue<T>(event);
+			return;
+		}
+
+		// subscribers may subscribe during delivery, which invalidates
+		// iterators, so list is indexed again for each subscriber
+		const size_t family = detail::Event<T>::getFamily();
+		for (size_t i = 0; i < m_subscribers[family].size(); ++i) {
+			static_cast<EventSubscriber<T>*>(m_subscribers[family][i])->onReceive(this, event);
+		}
+	}
+
+	// Puts event to queue which is delivered in dispatchEvents call
+	template<typename T>
+	void enqueue(const T& event)
+	{
+		if (!hasSubscribers<T>()) {
+			return;
+		}
+
+		size_t family = detail::Event<T>::getFamily();
+		if (m_eventQueues.size() <= family) {
+			m_eventQueues.resize(family + 1);
+		}
+
+		auto& queue = m_eventQueues[family];
+		if (queue == nullptr) {
+			queue = std::make_unique<detail::EventQueue<T>>();
+		}
+
+		static_cast<detail::EventQueue<T>*>(queue.get())->m_events.push_back(event);
+	}
+
+	// Delivers all queued events, one batch per event type
+	void dispatchEvents();
+
+	template<typename T>
+	void subscribe(EventSubscriber<T>* subscriber)
+	{
+		size_t family = detail::Event<T>::getFamily();
+		if (m_subscribers.size() <= family) {
+			m_subscribers.resize(family + 1);
+		}
+
+		m_subscribers[family].push_back(subscriber);
+	}
+
+	template<typename T>
+	void unsubscribe(EventSubscriber<T>* subscriber)
+	{
+		size_t family = detail::Event<T>::getFamily();
+		if (family < m_subscribers.size()) {
+			auto& subscribers = m_subscribers[family];
+			subscribers.erase(std::remove(subscribers.begin(), subscribers.end(), subscriber), subscribers.end());
+		}
+	}
+
+private:
+	template<typename T>
+	friend class ComponentHandle;
+	template<typename T>
+	friend class detail::ComponentList;
+	template<typename T>
+	friend class detail::TypedComponentCommand;
+	friend class WorldSnapshot;
+	friend class Prefab;
+	friend class GameObject;
+
+	// Same as assign and remove, but without events
+	template<typename T, typename... Args>
+	ComponentHandle<T> emplaceComponent(EntityId id, Args&&... args)
+	{
+		size_t family = getComponentFamily<T>();
+		PoolType<T>* pool = accommodate<T>();
+
+		pool->emplace(id.getIndex(), m_changeVersion, std::forward<Args>(args)...);
+
+		setComponentFlag(id.getIndex(), family);
+
+		return ComponentHandle<T>(this, id);
+	}
+
+	template<typename T>
+	void eraseComponent(EntityId id)
+	{
+		size_t family = getComponentFamily<T>();
+		uint32_t index = id.getIndex();
+
+		resetComponentFlag(index, family);
+
+		auto& pool = m_componentPools[family];
+		pool->erase(index);
+	}
+
+	// Non const access marks component as changed
+	template<typename T>
+	T* getComponentPtr(EntityId id)
+	{
+		static_assert(!SoALayout<typename std::remove_const<T>::type>::isSoA, 
+			"SoA components can't be accessed by pointer, use load and store");
+
+		BasePool* pool = m_componentPools[getComponentFamily<T>()].get();
+
+		const uint32_t position = pool->find(id.getIndex());
+		if (position == BasePool::INVALID_INDEX) {
+			return nullptr;
+		}
+
+		if (!std::is_const<T>::value) {
+			pool->markChanged(position, m_changeVersion);
+		}
+		return reinterpret_cast<T*>(pool->at(position));
 	}
 
 	template<typename T>
 	const T* getComponentPtr(EntityId id) const
 	{
+		static_assert(!SoALayout<typename std::remove_const<T>::type>::isSoA, 
+			"SoA components can't be accessed by pointer, use load and store");
+
 		BasePool* pool = m_componentPools[getComponentFamily<T>()].get();
 		return reinterpret_cast<const T*>(pool->get(id.getIndex()));
 	}
 
+	template<typename T>
+	T loadComponent(EntityId id) const
+	{
+		const auto* pool = getPool<T>();
+		return pool->load(pool->find(id.getIndex()));
+	}
+
+	// Stored component is marked as changed
+	template<typename T>
+	void storeComponent(EntityId id, const T& value)
+	{
+		auto* pool = getPool<T>();
+		const uint32_t position = pool->find(id.getIndex());
+		pool->store(position, value);
+		pool->markChanged(position, m_changeVersion);
+	}
+
+	// Returns entity indices of registered query with the same mask 
+	// or of the smallest pool from mask
+	const std::vector<uint32_t>* getCandidates(const ComponentMask& mask) const;
+
+	// Returns registered query with specified mask or nullptr
+	const detail::CachedQuery* findQuery(const ComponentMask& mask) const;
+
+	// Update queries which depend on component family of entity
+	void addToQueries(uint32_t index, size_t family);
+	void removeFromQueries(uint32_t index, size_t family);
+
+	// Moves entity into or out of group which owns component family
+	// Must be called after flag is set and before it is reset
+	void addToGroup(uint32_t index, size_t family);
+	void removeFromGroup(uint32_t index, size_t family);
+
+	// Returns group which owns exactly specified components or nullptr
+	template<typename... Ts>
+	const detail::OwningGroup* findGroup()
+	{
+		if (sizeof...(Ts) < 2 || m_groups.empty()) {
+			return nullptr;
+		}
+
+		const size_t families[] = { getComponentFamily<Ts>()... };
+		if (families[0] >= m_componentGroups.size() || m_componentGroups[families[0]] == nullptr) {
+			return nullptr;
+		}
+
+		const detail::OwningGroup* group = m_componentGroups[families[0]];
+		return group->mask == getComponentMask<Ts...>() ? group : nullptr;
+	}
+
+	// Takes free index or creates new one without GameObject and events
+	EntityId allocateEntity();
+	std::vector<EntityId> allocateEntities(size_t count);
+
+	template<typename T>
+	using PoolType = ComponentPool<typename std::remove_const<typename detail::QueryTraits<T>::Component>::type>;
+
+	// Creates pool and helper for component type if they don't exist
+	template<typename T>
+	PoolType<T>* accommodate()
+	{
+		size_t family = getComponentFamily<T>();
+
+		while (m_componentPools.size() <= family) {
+			m_componentPools.emplace_back(nullptr);
+		}
+
+		while (m_componentHelpers.size() <= family) {
+			m_componentHelpers.emplace_back(nullptr);
+		}
+
+		if (m_componentBitmaps.size() <= family) {
+			m_componentBitmaps.resize(family + 1, std::vector<uint64_t>(m_aliveEntities.size(), 0));
+		}
+
+		auto& pool = m_componentPools[family];
+		if (pool == nullptr) {
+			pool = std::make_unique<PoolType<T>>();
+		}
+
+		auto& helper = m_componentHelpers[family];
+		if (helper == nullptr) {
+			helper = std::make_unique<detail::ComponentHelper<T>>();
+		}
+
+		return static_cast<PoolType<T>*>(pool.get());
+	}
+
+	template<typename T>
+	void assignMany(const std::vector<EntityId>& entities, const T& component)
+	{
+		size_t family = getComponentFamily<T>();
+		PoolType<T>* pool = accommodate<T>();
+
+		pool->reserve(pool->getSize() + entities.size());
+		for (auto id : entities) {
+			pool->emplace(id.getIndex(), m_changeVersion, component);
+			setComponentFlag(id.getIndex(), family);
+		}
+	}
+
+	// Assigns copies of values to entities which don't have component yet
+	// i-th entity gets values[i % values.size()]. Trivially copyable
+	// components are appended to pool at once and copied as bytes
+	template<typename T, typename V>
+	void assignCopies(const std::vector<EntityId>& entities, const std::vector<V>& values)
+	{
+		size_t family = getComponentFamily<T>();
+		PoolType<T>* pool = accommodate<T>();
+
+		if constexpr (std::is_same<PoolType<T>, Pool<T>>::value && std::is_same<T, V>::value && 
+			std::is_trivially_copyable<T>::value)
+		{
+			std::vector<uint32_t> indices(entities.size());
+			for (size_t i = 0; i < entities.size(); ++i) {
+				indices[i] = entities[i].getIndex();
+			}
+
+			const size_t begin = pool->append(indices.data(), indices.size(), m_changeVersion);
+			for (size_t i = 0; i < entities.size(); ++i) {
+				std::memcpy(pool->at(begin + i), &values[i % values.size()], sizeof(T));
+			}
+		}
+		else {
+			pool->reserve(pool->getSize() + entities.size());
+			for (size_t i = 0; i < entities.size(); ++i) {
+				pool->emplace(entities[i].getIndex(), m_changeVersion, values[i % values.size()]);
+			}
+		}
+
+		for (auto id : entities) {
+			setComponentFlag(id.getIndex(), family);
+		}
+	}
+
+	template<typename T>
+	PoolType<T>* getPool() const
+	{
+		size_t family = getComponentFamily<T>();
+		if (family >= m_componentPools.size()) {
+			return nullptr;
+		}
+
+		return static_cast<PoolType<T>*>(m_componentPools[family].get());
+	}
+
+	// Returns the smallest pool of specified components or nullptr if some of them has no pool
+	// Filtered pools are preferred, so their unchanged chunks can be skipped
+	template<typename... Ts>
+	const BasePool* getDrivingPool() const
+	{
+		const BasePool* pools[] = { getPool<Ts>()... };
+		const bool isFiltered[] = { (detail::QueryTraits<Ts>::filter != detail::NO_FILTER)... };
+
+		const BasePool* smallest = nullptr;
+		bool isSmallestFiltered = false;
+		for (size_t i = 0; i < sizeof...(Ts); ++i) {
+			if (pools[i] == nullptr) {
+				return nullptr;
+			}
+
+			if (smallest == nullptr || isFiltered[i] > isSmallestFiltered ||
+				(isFiltered[i] == isSmallestFiltered && pools[i]->getSize() < smallest->getSize()))
+			{
+				smallest = pools[i];
+				isSmallestFiltered = isFiltered[i];
+			}
+		}
+
+		return smallest;
+	}
+
+	template<typename... Ts>
+	void initFilters(detail::ChangeFilters& filters, const std::vector<uint32_t>*& candidates) const
+	{
+		const BasePool* pools[] = { getPool<Ts>()... };
+		const detail::QueryFilter queryFilters[] = { detail::QueryTraits<Ts>::filter... };
+
+		filters.since = m_lastUpdateVersion;
+		for (size_t i = 0; i < sizeof...(Ts); ++i) {
+			if (queryFilters[i] == detail::NO_FILTER || pools[i] == nullptr) {
+				continue;
+			}
+
+			filters.pools.push_back(pools[i]);
+			filters.filters.push_back(queryFilters[i]);
+		}
+
+		// empty candidates mean that some pool doesn't exist
+		if (filters.pools.empty() || candidates->empty()) {
+			filters.pools.clear();
+			return;
+		}
+
+		auto smallest = std::min_element(filters.pools.begin(), filters.pools.end(),
+			[](const BasePool* a, const BasePool* b) { return a->getSize() < b->getSize(); });
+		size_t driver = smallest - filters.pools.begin();
+		std::swap(filters.pools[0], filters.pools[driver]);
+		std::swap(filters.filters[0], filters.filters[driver]);
+
+		candidates = &filters.pools[0]->getEntityIndices();
+	}
+
+	// Returns the lowest entity index starting from specified one which is 
+	// set in all bitmaps or capacity if there is no such entity
+	uint32_t findMatchingEntity(uint32_t index, const Bitmaps& bitmaps) const
+	{
+		const size_t wordCount = m_aliveEntities.size();
+
+		size_t word = index / 64;
+		if (word >= wordCount) {
+			return static_cast<uint32_t>(getCapacity());
+		}
+
+		uint64_t bits = ~0ULL << (index % 64);
+		for (auto* bitmap : bitmaps) {
+			bits &= (*bitmap)[word];
+		}
+
+		if (bits == 0) {
+			word = detail::findCommonBits(bitmaps.data(), bitmaps.size(), word + 1, wordCount, bits);
+			if (word == wordCount) {
+				return static_cast<uint32_t>(getCapacity());
+			}
+		}
+
+		return static_cast<uint32_t>(word * 64 + detail::countTrailingZeros(bits));
+	}
+
+	// Fills bitmaps of components from mask if matching them word by word
+	// is cheaper than checking masks of candidates
+	void chooseBitmaps(const ComponentMask& mask, size_t candidateCount, Bitmaps& bitmaps) const;
+
+	// Updates component mask, bitmap and queries of entity
+	void setComponentFlag(uint32_t index, size_t family);
+	void resetComponentFlag(uint32_t index, size_t family);
+
+	// Same as setComponentFlag for several entities. When no query or
+	// group uses family, only masks and bitmap are updated
+	void setComponentFlags(const uint32_t* indices, size_t count, size_t family);
+
+	void setAlive(uint32_t index, bool alive)
+	{
+		if (alive) {
+			m_aliveEntities[index / 64] |= 1ULL << (index % 64);
+		}
+		else {
+			m_aliveEntities[index / 64] &= ~(1ULL << (index % 64));
+		}
+	}
+
+	// Returns entities of registered query with specified components
+	// or entities of driving pool
+	template<typename... Ts>
+	const std::vector<uint32_t>& getDrivingEntities(const BasePool* driver)
+	{
+		if (sizeof...(Ts) > 1 && !m_queries.empty()) {
+			const detail::CachedQuery* query = findQuery(getComponentMask<Ts...>());
+			if (query != nullptr) {
+				return query->getEntityIndices();
+			}
+		}
+
+		return driver->getEntityIndices();
+	}
+
+	// Iterates over created entities in words [begin, end) of alive bitmap
+	template<typename Func>
+	void eachAlive(Func& func, size_t begin, size_t end)
+	{
+		for (size_t word = begin; word < end; ++word) {
+			uint64_t bits = m_aliveEntities[word];
+			while (bits != 0) {
+				func(createId(static_cast<uint32_t>(word * 64 + detail::countTrailingZeros(bits))));
+				bits &= bits - 1;
+			}
+		}
+	}
+
+	// Iterates over positions [begin, end) of entities list
+	// which is either driving pool or cached query
+	template<typename... Ts, typename Func>
+	void eachInRange(Func& func, const BasePool* driver, const std::vector<uint32_t>& entities, size_t begin, size_t end, uint32_t since)
+	{
+		if constexpr (sizeof...(Ts) == 1) {
+			eachSingle<Ts...>(func, begin, end, since);
+		}
+		else {
+			eachImpl<Ts...>(func, driver, entities, begin, end, since, std::index_sequence_for<Ts...>{});
+		}
+	}
+
+	// Iterates over positions [begin, end) of group
+	// Components of grouped entity have the same position in all pools
+	template<typename... Ts, typename Func, size_t... Is>
+	void eachGrouped(Func& func, size_t begin, size_t end, uint32_t since, std::index_sequence<Is...>)
+	{
+		static_assert(!std::disjunction<std::bool_constant<SoALayout<typename std::remove_const<typename detail::QueryTraits<Ts>::Component>::type>::isSoA>...>::value, 
+			"SoA components are iterated by eachStream");
+
+		const std::tuple<PoolType<Ts>*...> pools(getPool<Ts>()...);
+
+		BasePool* basePools[] = { std::get<Is>(pools)... };
+		const detail::QueryFilter filters[] = { detail::QueryTraits<Ts>::filter... };
+		const bool isWritten[] = { !std::is_const<typename detail::QueryTraits<Ts>::Component>::value... };
+
+		const std::vector<uint32_t>& entities = basePools[0]->getEntityIndices();
+		const size_t chunkSize = basePools[0]->getChunkSize();
+
+		while (begin < end) {
+			const size_t chunk = begin / chunkSize;
+			const size_t chunkEnd = std::min(end, (chunk + 1) * chunkSize);
+
+			bool skipped = false;
+			for (size_t j = 0; j < sizeof...(Ts) && !skipped; ++j) {
+				skipped = filters[j] != detail::NO_FILTER && 
+					detail::getChunkVersion(*basePools[j], filters[j], chunk) <= since;
+			}
+
+			if (skipped) {
+				begin = chunkEnd;
+				continue;
+			}
+
+			const auto components = std::make_tuple(std::get<Is>(pools)->at(begin)...);
+			for (size_t i = begin; i < chunkEnd; ++i) {
+				bool matches = true;
+				for (size_t j = 0; j < sizeof...(Ts) && matches; ++j) {
+					matches = filters[j] == detail::NO_FILTER || detail::getVersion(*basePools[j], filters[j], i) > since;
+				}
+
+				if (!matches) {
+					continue;
+				}
+
+				for (size_t j = 0; j < sizeof...(Ts); ++j) {
+					if (isWritten[j]) {
+						basePools[j]->markChanged(i, m_changeVersion);
+					}
+				}
+				func(createId(entities[i]), std::get<Is>(components)[i - begin]...);
+			}
+
+			begin = chunkEnd;
+		}
+	}
+
+	template<typename Q, typename Func>
+	void eachStreamInRange(Func& func, size_t begin, size_t end, uint32_t since)
+	{
+		typedef typename detail::QueryTraits<Q>::Component T;
+		const detail::QueryFilter filter = detail::QueryTraits<Q>::filter;
+
+		static_assert(SoALayout<typename std::remove_const<T>::type>::isSoA, 
+			"Only SoA components have streams");
+
+		auto* pool = getPool<Q>();
+		typename std::conditional<std::is_const<T>::value, const PoolType<Q>&, PoolType<Q>&>::type target = *pool;
+
+		const size_t chunkSize = pool->getChunkSize();
+
+		while (begin < end) {
+			const size_t chunk = begin / chunkSize;
+			const size_t chunkEnd = std::min(end, (chunk + 1) * chunkSize);
+
+			if (filter == detail::NO_FILTER || detail::getChunkVersion(*pool, filter, chunk) > since) {
+				if (!std::is_const<T>::value) {
+					for (size_t i = begin; i < chunkEnd; ++i) {
+						pool->markChanged(i, m_changeVersion);
+					}
+				}
+				target.visitStreams(begin, chunkEnd, func);
+			}
+
+			begin = chunkEnd;
+		}
+	}
+
+	template<typename Q, typename Func>
+	void eachSingle(Func& func, size_t begin, size_t end, uint32_t since)
+	{
+		typedef typename detail::QueryTraits<Q>::Component T;
+		const detail::QueryFilter filter = detail::QueryTraits<Q>::filter;
+
+		static_assert(!SoALayout<typename std::remove_const<T>::type>::isSoA, 
+			"SoA components are iterated by eachStream");
+
+		auto* pool = getPool<Q>();
+
+		const std::vector<uint32_t>& entities = pool->getEntityIndices();
+		const size_t chunkSize = pool->getChunkSize();
+
+		while (begin < end) {
+			const size_t chunk = begin / chunkSize;
+			const size_t chunkEnd = std::min(end, (chunk + 1) * chunkSize);
+
+			if (filter != detail::NO_FILTER && detail::getChunkVersion(*pool, filter, chunk) <= since) {
+				begin = chunkEnd;
+				continue;
+			}
+
+			T* components = pool->at(begin);
+			for (size_t i = begin; i < chunkEnd; ++i) {
+				if (filter != detail::NO_FILTER && detail::getVersion(*pool, filter, i) <= since) {
+					continue;
+				}
+
+				if (!std::is_const<T>::value) {
+					pool->markChanged(i, m_changeVersion);
+				}
+				func(createId(entities[i]), components[i - begin]);
+			}
+
+			begin = chunkEnd;
+		}
+	}
+
+	template<typename... Ts, typename Func, size_t... Is>
+	void eachImpl(Func& func, const BasePool* driver, const std::vector<uint32_t>& entities, 
+		size_t begin, size_t end, uint32_t since, std::index_sequence<Is...>)
+	{
+		static_assert(!std::disjunction<std::bool_constant<SoALayout<typename std::remove_const<typename detail::QueryTraits<Ts>::Component>::type>::isSoA>...>::value, 
+			"SoA components are iterated by eachStream");
+
+		const std::tuple<PoolType<Ts>*...> pools(getPool<Ts>()...);
+
+		BasePool* basePools[] = { std::get<Is>(pools)... };
+		const detail::QueryFilter filters[] = { detail::QueryTraits<Ts>::filter... };
+		const bool isWritten[] = { !std::is_const<typename detail::QueryTraits<Ts>::Component>::value... };
+
+		// only filter of driving pool allows to skip whole chunks
+		detail::QueryFilter driverFilter = detail::NO_FILTER;
+		for (size_t j = 0; j < sizeof...(Ts) && &entities == &driver->getEntityIndices(); ++j) {
+			if (basePools[j] == driver && filters[j] != detail::NO_FILTER) {
+				driverFilter = filters[j];
+				break;
+			}
+		}
+
+		const size_t chunkSize = driver->getChunkSize();
+
+		while (begin < end) {
+			const size_t chunk = begin / chunkSize;
+			const size_t chunkEnd = std::min(end, (chunk + 1) * chunkSize);
+
+			if (driverFilter != detail::NO_FILTER && detail::getChunkVersion(*driver, driverFilter, chunk) <= since) {
+				begin = chunkEnd;
+				continue;
+			}
+
+			for (size_t i = begin; i < chunkEnd; ++i) {
+				const uint32_t index = entities[i];
+				const uint32_t positions[] = { std::get<Is>(pools)->find(index)... };
+
+				bool matches = true;
+				for (size_t j = 0; j < sizeof...(Ts) && matches; ++j) {
+					matches = positions[j] != BasePool::INVALID_INDEX && (filters[j] == detail::NO_FILTER ||
+						detail::getVersion(*basePools[j], filters[j], positions[j]) > since);
+				}
+
+				if (!matches) {
+					continue;
+				}
+
+				for (size_t j = 0; j < sizeof...(Ts); ++j) {
+					if (isWritten[j]) {
+						basePools[j]->markChanged(positions[j], m_changeVersion);
+					}
+				}
+				func(createId(index), *std::get<Is>(pools)->at(positions[Is])...);
+			}
+
+			begin = chunkEnd;
+		}
+	}
+
+	// Iterates over entities visited by view iterator, which already checked
+	// masks and filters, so only positions in pools are looked up
+	template<typename... Ts, typename Iterator, typename Func, size_t... Is>
+	void eachInView(Func& func, Iterator it, const Iterator& end, std::index_sequence<Is...>)
+	{
+		static_assert(!std::disjunction<std::bool_constant<SoALayout<typename std::remove_const<typename detail::QueryTraits<Ts>::Component>::type>::isSoA>...>::value,
+			"SoA components are iterated by eachStream");
+
+		const std::tuple<PoolType<Ts>*...> pools(getPool<Ts>()...);
+
+		BasePool* basePools[] = { std::get<Is>(pools)... };
+		const bool isWritten[] = { !std::is_const<typename detail::QueryTraits<Ts>::Component>::value... };
+
+		for (; it != end; ++it) {
+			const EntityId id = *it;
+			const uint32_t positions[] = { std::get<Is>(pools)->find(id.getIndex())... };
+
+			for (size_t j = 0; j < sizeof...(Ts); ++j) {
+				if (isWritten[j]) {
+					basePools[j]->markChanged(positions[j], m_changeVersion);
+				}
+			}
+			func(id, *std::get<Is>(pools)->at(positions[Is])...);
+		}
+	}
+
 	uint32_t m_currentIndex;
 
 	std::vector<std::unique_ptr<BasePool>> m_componentPools;
@@ -700,19 +1868,72 @@ private:
 	std::vector<ComponentMask> m_entityComponentMasks;
 	std::vector<uint32_t> m_entityVersions;
 
-	std::vector<std::shared_ptr<GameObject>> m_gameObjects;
+	GameObjectPool m_gameObjects;
+	uint32_t m_hierarchyVersion;
 
+	// min heap, so the lowest free index is reused first
 	std::vector<uint32_t> m_availableIndices;
+	// bit per entity index, set for created entities
+	std::vector<uint64_t> m_aliveEntities;
+	// bitmaps of the same size for each component family
+	std::vector<std::vector<uint64_t>> m_componentBitmaps;
 
 	std::vector<std::shared_ptr<EntitySystem>> m_systems;
-	std::unordered_map<std::type_index,
-		std::vector<detail::BaseEventSubscriber*>,
-		std::hash<std::type_index>,
-		std::equal_to<std::type_index>> m_subscribers;
+	std::vector<std::vector<EntitySystem*>> m_systemStages;
+	bool m_systemStagesChanged;
+
+	std::vector<std::unique_ptr<detail::CachedQuery>> m_queries;
+	std::vector<std::vector<detail::CachedQuery*>> m_componentQueries;
+
+	std::vector<std::unique_ptr<detail::OwningGroup>> m_groups;
+	// group which owns component family or nullptr
+	std::vector<detail::OwningGroup*> m_componentGroups;
+
+	uint32_t m_changeVersion;
+	// change version of the previous update of the system running on this thread
+	static thread_local uint32_t m_lastUpdateVersion;
+
+	std::unique_ptr<EntityCommandBuffer> m_commandBuffer;
+	std::vector<std::vector<detail::BaseEventSubscriber*>> m_subscribers;
+	std::vector<std::unique_ptr<detail::BaseEventQueue>> m_eventQueues;
+	EventMode m_eventMode;
 
 };
 
 
+template<typename... Ts>
+inline void EntitySystem::reads()
+{
+	using dummy = int[];
+	(void)dummy {
+		0, (m_readMask.set(EntityManager::getComponentFamily<Ts>()), 0)...
+	};
+	m_hasDeclaredAccess = true;
+}
+
+template<typename... Ts>
+inline void EntitySystem::writes()
+{
+	using dummy = int[];
+	(void)dummy {
+		0, (m_writeMask.set(EntityManager::getComponentFamily<Ts>()), 0)...
+	};
+	m_hasDeclaredAccess = true;
+}
+
+
+template<typename T>
+inline void detail::EventQueue<T>::dispatch(EntityManager* manager, const std::vector<BaseEventSubscriber*>& subscribers)
+{
+	std::vector<T> events;
+	events.swap(m_events);
+
+	for (auto* subscriber : subscribers) {
+		static_cast<EventSubscriber<T>*>(subscriber)->onReceiveBatch(manager, events);
+	}
+}
+
+
 template<typename T>
 inline void detail::ComponentHelper<T>::removeComponent(EntityManager* manager, EntityId id)
 {
@@ -722,7 +1943,56 @@ inline void detail::ComponentHelper<T>::removeComponent(EntityManager* manager,
 template<typename T>
 inline void detail::ComponentHelper<T>::copyComponentTo(EntityManager* manager, EntityId source, EntityId target)
 {
-	manager->assign<T>(source, std::forward<const T&>(*(manager->getComponent<T>(source).get())));
+	manager->assign<T>(target, manager->getComponent<T>(source).load());
+}
+
+template<typename T>
+inline std::unique_ptr<detail::BaseComponentList> detail::ComponentHelper<T>::createList() const
+{
+	return std::make_unique<ComponentList<T>>();
+}
+
+
+template<typename T>
+inline void detail::ComponentList<T>::push(EntityManager* manager, EntityId source, uint32_t node)
+{
+	m_values.push_back(manager->getComponent<T>(source).load());
+	m_nodes.push_back(node);
+}
+
+template<typename T>
+inline void detail::ComponentList<T>::assignTo(EntityManager* manager, const std::vector<EntityId>& entities, size_t nodeCount) const
+{
+	std::vector<EntityId> targets;
+	targets.reserve(entities.size() / nodeCount * m_nodes.size());
+	for (size_t instance = 0; instance < entities.size(); instance += nodeCount) {
+		for (auto node : m_nodes) {
+			targets.push_back(entities[instance + node]);
+		}
+	}
+
+	manager->assignCopies<T>(targets, m_values);
+}
+
+template<typename T>
+inline void detail::ComponentList<Shared<T>>::push(EntityManager* manager, EntityId source, uint32_t node)
+{
+	m_values.push_back(*manager->getComponent<Shared<T>>(source).load());
+	m_nodes.push_back(node);
+}
+
+template<typename T>
+inline void detail::ComponentList<Shared<T>>::assignTo(EntityManager* manager, const std::vector<EntityId>& entities, size_t nodeCount) const
+{
+	std::vector<EntityId> targets;
+	targets.reserve(entities.size() / nodeCount * m_nodes.size());
+	for (size_t instance = 0; instance < entities.size(); instance += nodeCount) {
+		for (auto node : m_nodes) {
+			targets.push_back(entities[instance + node]);
+		}
+	}
+
+	manager->assignCopies<Shared<T>>(targets, m_values);
 }
 
 
@@ -760,7 +2030,7 @@ template<typename T>
 inline const T * ComponentHandle<T>::operator->() const
 {
 	if (isValid()) {
-		return m_manager->getComponentPtr<T>(m_entityId);
+		return static_cast<const EntityManager*>(m_manager)->getComponentPtr<T>(m_entityId);
 	}
 	else {
 		return nullptr;
@@ -782,9 +2052,28 @@ template<typename T>
 inline const T * ComponentHandle<T>::get() const
 {
 	if (isValid()) {
-		return m_manager->getComponentPtr<T>(m_entityId);
+		return static_cast<const EntityManager*>(m_manager)->getComponentPtr<T>(m_entityId);
 	}
 	else {
 		return nullptr;
 	}
+}
+
+template<typename T>
+inline T ComponentHandle<T>::load() const
+{
+	if (isValid()) {
+		return m_manager->loadComponent<T>(m_entityId);
+	}
+	else {
+		throw std::runtime_error("Unable to load component. Handle is invalid");
+	}
+}
+
+template<typename T>
+inline void ComponentHandle<T>::store(const T& value)
+{
+	if (isValid()) {
+		m_manager->storeComponent<T>(m_entityId, value);
+	}
 }
\ No newline at end of file
@@ -14,7 +14,7 @@ FxaaMaterial::FxaaMaterial() :
 	m_shader->setAttribute(1, "texCoord");
 }
 
-void FxaaMaterial::bind()
+void FxaaMaterial::bind() const
 {
 	m_shader->bind();
 }
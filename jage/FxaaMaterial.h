@@ -7,7 +7,7 @@ class FxaaMaterial : public Material
 public:
 	FxaaMaterial();
 
-	void bind() override;
+	void bind() const override;
 
 	//TODO: add fxaa properties
 
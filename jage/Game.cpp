@@ -6,6 +6,12 @@ void Game::onInit()
 	m_entityManager = std::make_shared<EntityManager>();
 
 	// Creating systems
+	m_transformSystem = std::make_shared<TransformSystem>();
+	m_entityManager->registerSystem(m_transformSystem);
+
+	m_boundsSystem = std::make_shared<BoundsSystem>();
+	m_entityManager->registerSystem(m_boundsSystem);
+
 	m_renderingSystem = std::make_shared<RenderingSystem>();
 	m_entityManager->registerSystem(m_renderingSystem);
 
@@ -35,9 +41,14 @@ void Game::onInit()
 	auto terrain = ResourceManager::get<Model>("terrain")->createGameObject(m_entityManager.get(), "terrain");
 	terrain->setScale(100.0f, 30.0f, 100.0f);
 
-	auto terrainMesh = terrain->getChildren()[0]->getChildren()[0];
-	if (terrainMesh->isValid() && terrainMesh->hasComponent<MeshComponent>()) {
-		terrainMesh->getComponent<MeshComponent>()->getMaterial()->as<MeshMaterial>()->setUVScale(vec2(2000.0f, 2000.0f));
+	GameObject* terrainMesh = terrain->getFirstChild() != nullptr ? terrain->getFirstChild()->getFirstChild() : nullptr;
+	if (terrainMesh != nullptr && terrainMesh->isValid() && terrainMesh->hasComponent<Shared<MeshComponent>>()) {
+		// model material is shared by all instances, so terrain gets its own copy
+		const MeshComponent* meshComponent = terrainMesh->getComponent<Shared<MeshComponent>>()->get();
+
+		auto material = std::make_shared<MeshMaterial>(*meshComponent->getMaterial()->as<MeshMaterial>());
+		material->setUVScale(vec2(2000.0f, 2000.0f));
+		terrainMesh->assign<Shared<MeshComponent>>(meshComponent->getMesh(), material);
 	}
 	rootObject->addChild(terrain);
 
@@ -51,7 +62,10 @@ void Game::onInit()
 	auto cameraComponent = m_camera->assign<CameraComponent>();
 
 	// Initializing systems
-	m_renderingSystem->setMainCamera(m_camera);
+	m_boundsSystem->setTransformSystem(m_transformSystem);
+
+	m_renderingSystem->setTransformSystem(m_transformSystem);
+	m_renderingSystem->setMainCamera(m_camera.get());
 
 	m_fxaaMaterial = std::make_unique<FxaaMaterial>();
 	m_renderingSystem->addPostProcess(0, m_fxaaMaterial.get());
@@ -59,7 +73,7 @@ void Game::onInit()
 	m_abberationMaterial = std::make_unique<AbberationMaterial>();
 	m_renderingSystem->addPostProcess(1, m_abberationMaterial.get());
 
-	m_skySystem->setSun(sun);
+	m_skySystem->setSun(sun.get());
 	m_skySystem->setTime(8, 0);
 
 	onResize(toGLM((Core::getWindow().getSize())));
@@ -76,10 +90,9 @@ void Game::onUpdate(const float dt)
 		return;
 	}
 
-	m_cameraController.update(dt, m_camera);
+	m_cameraController.update(dt, m_camera.get());
 
-	m_renderingSystem->update(dt);
-	m_skySystem->update(dt);
+	m_entityManager->update(dt);
 }
 
 void Game::onResize(const ivec2& windowSize)
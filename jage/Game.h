@@ -4,6 +4,8 @@
 #include "SceneManager.h"
 
 #include "FirstPersonController.h"
+#include "TransformSystem.h"
+#include "BoundsSystem.h"
 #include "RenderingSystem.h"
 #include "SkySystem.h"
 
@@ -23,6 +25,8 @@ public:
 
 private:
 	std::shared_ptr<EntityManager> m_entityManager;
+	std::shared_ptr<TransformSystem> m_transformSystem;
+	std::shared_ptr<BoundsSystem> m_boundsSystem;
 	std::shared_ptr<RenderingSystem> m_renderingSystem;
 	std::shared_ptr<SkySystem> m_skySystem;
 
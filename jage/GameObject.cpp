@@ -4,28 +4,25 @@
 #define GLM_ENABLE_EXPERIMENTAL
 #endif
 
-#include <stack>
-
 #include <glm/gtx/matrix_decompose.hpp>
 
+#include "Prefab.h"
 #include "Log.h"
 
 GameObject::GameObject(EntityManager * manager, EntityId id) :
-	m_isActive(true), m_parent(nullptr), 
+	m_isActive(true),
 	m_manager(manager), m_id(id), m_isPendingDestroy(false),
 	m_position(0.0f, 0.0f, 0.0f), m_rotation(1.0f, 0.0f, 0.0f, 0.0f), m_scale(1.0f, 1.0f, 1.0f),
 	m_directionFront(0.0f, 0.0f, -1.0f), m_directionRight(1.0f, 0.0f, 0.0f), m_directionUp(0.0f, 1.0f, 0.0f),
 	m_transformation(1.0f),
-	m_positionMatrix(1.0f), m_positionMatrixInversed(1.0f),
-	m_rotationMatrix(1.0f), m_rotationMatrixInversed(1.0f),
-	m_scaleMatrix(1.0f), m_scaleMatrixInversed(1.0f),
-	m_positionChanged(true), m_rotationChanged(true), m_scaleChanged(true), m_transformationChanged(true)
+	m_positionMatrix(1.0f), m_rotationMatrix(1.0f), m_scaleMatrix(1.0f),
+	m_positionChanged(true), m_rotationChanged(true), m_scaleChanged(true), m_transformationChanged(true),
+	m_isTransformDirty(true)
 {
 }
 
 GameObject::~GameObject()
 {
-	m_children.clear();
 }
 
 void GameObject::setActive(bool active)
@@ -40,20 +37,35 @@ bool GameObject::isActive() const
 
 void GameObject::setName(const std::string & name)
 {
-	m_name = name;
+	if (isValid()) {
+		m_manager->m_gameObjects.setName(m_id.getIndex(), StringId::intern(name));
+	}
+	else {
+		m_name = StringId::intern(name);
+	}
+}
+
+const std::string & GameObject::getName() const
+{
+	return m_name.getString();
 }
 
-std::string GameObject::getName() const
+StringId GameObject::getNameId() const
 {
 	return m_name;
 }
 
 void GameObject::setTag(const std::string & tag)
 {
-	m_tag = tag;
+	m_tag = StringId::intern(tag);
 }
 
-std::string GameObject::getTag() const
+const std::string & GameObject::getTag() const
+{
+	return m_tag.getString();
+}
+
+StringId GameObject::getTagId() const
 {
 	return m_tag;
 }
@@ -75,18 +87,39 @@ bool GameObject::isPendingDestroy() const
 
 std::shared_ptr<GameObject> GameObject::clone()
 {
-	//TODO: implement
-	return nullptr;
+	return Prefab(*this).instantiate();
 }
 
 void GameObject::setParent(GameObject * parent)
 {
-	m_parent = parent;
+	if (!isValid() || (parent != nullptr && (parent->m_manager != m_manager || !parent->isValid()))) {
+		return;
+	}
+
+	// object can't become child of its own descendant
+	for (const GameObject* ancestor = parent; ancestor != nullptr; ancestor = ancestor->getParent()) {
+		if (ancestor == this) {
+			return;
+		}
+	}
+
+	m_manager->m_gameObjects.link(m_id.getIndex(), parent != nullptr ? parent->m_id.getIndex() : BasePool::INVALID_INDEX);
+	++m_manager->m_hierarchyVersion;
 }
 
 GameObject * GameObject::getParent() const
 {
-	return m_parent;
+	return getLinked(&HierarchyNode::parent);
+}
+
+GameObject * GameObject::getFirstChild() const
+{
+	return getLinked(&HierarchyNode::firstChild);
+}
+
+GameObject * GameObject::getNextSibling() const
+{
+	return getLinked(&HierarchyNode::nextSibling);
 }
 
 void GameObject::addChild(std::shared_ptr<GameObject> object)
@@ -95,98 +128,71 @@ void GameObject::addChild(std::shared_ptr<GameObject> object)
 		return;
 	}
 
-	if (object->m_parent != nullptr) {
-		object = object->m_parent->detachChildByName(object->m_name);
-	}
-
 	object->setParent(this);
-	m_children.push_back(std::move(object));
 }
 
-GameObject * GameObject::getChildByName(const std::string & name, bool deep)
+GameObject * GameObject::getChildByName(StringId name, bool deep)
 {
-	std::stack<GameObject*> objects;
-	objects.push(this);
-
-	while (!objects.empty()) {
-		GameObject* object = objects.top();
-		objects.pop();
+	if (m_manager == nullptr) {
+		return nullptr;
+	}
 
-		for (auto it = object->m_children.begin(); it != object->m_children.end(); ++it) {
-			auto& child = (*it);
+	const GameObjectPool& objects = m_manager->m_gameObjects;
+	const uint32_t root = m_id.getIndex();
 
-			if (child->m_name == name) {
-				return child.get();
-			}
-			else {
-				objects.push(child.get());
-			}
+	uint32_t index = objects.getNode(root).firstChild;
+	while (index != BasePool::INVALID_INDEX) {
+		GameObject* object = objects.get(index);
+		if (object->m_name == name) {
+			return object;
 		}
 
-		if (!deep) break;
+		index = deep ? objects.getNextInSubtree(index, root) : objects.getNode(index).nextSibling;
 	}
 
 	return nullptr;
 }
 
-void GameObject::deleteChildByName(const std::string & name, bool deep)
+void GameObject::deleteChildByName(StringId name, bool deep)
 {
-	std::stack<GameObject*> objects;
-	objects.push(this);
-
-	while (!objects.empty()) {
-		GameObject* object = objects.top();
-		objects.pop();
+	GameObject* child = getChildByName(name, deep);
+	if (child == nullptr) {
+		return;
+	}
 
-		for (auto it = object->m_children.begin(); it != object->m_children.end(); ++it) {
-			auto& child = (*it);
+	// child is destroyed with all its descendants
+	const GameObjectPool& objects = m_manager->m_gameObjects;
+	const uint32_t root = child->m_id.getIndex();
 
-			if (child->m_name == name) {
-				child->m_children.erase(it);
-				return;
-			}
-			else {
-				objects.push(child.get());
-			}
-		}
+	std::vector<EntityId> entities;
+	for (uint32_t index = root; index != BasePool::INVALID_INDEX; index = objects.getNextInSubtree(index, root)) {
+		entities.push_back(objects.get(index)->m_id);
+	}
 
-		if (!deep) break;
+	m_manager->destroyMany(entities);
+	for (auto id : entities) {
+		objects.get(id.getIndex())->invalidate();
 	}
 }
 
-std::shared_ptr<GameObject> GameObject::detachChildByName(const std::string & name, bool deep)
+std::shared_ptr<GameObject> GameObject::detachChildByName(StringId name, bool deep)
 {
-	std::stack<GameObject*> objects;
-	objects.push(this);
-
-	while (!objects.empty()) {
-		GameObject* object = objects.top();
-		objects.pop();
-
-		for (auto it = object->m_children.begin(); it != object->m_children.end(); ++it) {
-			auto& child = (*it);
-
-			if (child->m_name == name) {
-				child->setParent(nullptr);
-
-				auto result = std::move(child);
-				child->m_children.erase(it);
-				return result;
-			}
-			else {
-				objects.push(child.get());
-			}
-		}
-
-		if (!deep) break;
+	GameObject* child = getChildByName(name, deep);
+	if (child == nullptr) {
+		return std::shared_ptr<GameObject>();
 	}
 
-	return std::shared_ptr<GameObject>();
+	child->setParent(nullptr);
+	return m_manager->m_gameObjects.share(child->m_id.getIndex());
 }
 
-std::vector<std::shared_ptr<GameObject>>& GameObject::getChildren()
+std::vector<GameObject*> GameObject::getChildren() const
 {
-	return m_children;
+	std::vector<GameObject*> children;
+	for (GameObject* child = getFirstChild(); child != nullptr; child = child->getNextSibling()) {
+		children.push_back(child);
+	}
+	return children;
 }
 
 std::bitset<MAX_COMPONENTS> GameObject::getComponentMask() const
@@ -226,18 +232,14 @@ bool GameObject::operator<(const GameObject & other) const
 	return other.m_id < m_id;
 }
 
-std::shared_ptr<GameObject> GameObject::create(EntityManager * manager, EntityId id)
-{
-	return std::make_shared<GameObject>(manager, id);
-}
-
 mat4 GameObject::getGlobalTransformation() const
 {
-	if (m_parent == nullptr) {
+	const GameObject* parent = getParent();
+	if (parent == nullptr) {
 		return getTransformationMatrix();
 	}
 	else {
-		return m_parent->getGlobalTransformation() * getTransformationMatrix();
+		return parent->getGlobalTransformation() * getTransformationMatrix();
 	}
 }
 
@@ -247,6 +249,10 @@ void GameObject::setTransformationMatrix(const mat4 & transform)
 	glm::vec4 perspective;
 
 	glm::decompose(transform, m_scale, m_rotation, m_position, skew, perspective);
+	m_positionChanged = true;
+	m_rotationChanged = true;
+	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 mat4 GameObject::getTransformationMatrix() const
@@ -272,9 +278,7 @@ mat4 GameObject::getPositionMatrix() const
 
 mat4 GameObject::getPositionMatrixInversed() const
 {
-	updatePosition();
-
-	return m_positionMatrixInversed;
+	return glm::translate(mat4(1.0f), -m_position);
 }
 
 mat4 GameObject::getRotationMatrix() const
@@ -288,7 +292,8 @@ mat4 GameObject::getRotationMatrixInversed() const
 {
 	updateRotation();
 
-	return m_rotationMatrixInversed;
+	// rotation matrix is orthogonal
+	return glm::transpose(m_rotationMatrix);
 }
 
 mat4 GameObject::getScaleMatrix() const
@@ -300,9 +305,7 @@ mat4 GameObject::getScaleMatrix() const
 
 mat4 GameObject::getScaleMatrixInversed() const
 {
-	updateScale();
-
-	return m_scaleMatrixInversed;
+	return glm::scale(mat4(1.0f), vec3(1.0f / m_scale.x, 1.0f / m_scale.y, 1.0f / m_scale.z));
 }
 
 void GameObject::move(float x, float y, float z)
@@ -311,24 +314,28 @@ void GameObject::move(float x, float y, float z)
 	m_position.y += y;
 	m_position.z += z;
 	m_positionChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::move(const vec3 & vector)
 {
 	m_position += vector;
 	m_positionChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setPosition(float x, float y, float z)
 {
 	m_position = vec3(x, y, z);
 	m_positionChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setPosition(const vec3 & position)
 {
 	m_position = position;
 	m_positionChanged = true;
+	m_isTransformDirty = true;
 }
 
 vec3 GameObject::getPosition() const
@@ -341,6 +348,7 @@ void GameObject::rotate(float x, float y, float z)
 	m_rotation = quat(vec3(math::radians(x), math::radians(y), math::radians(z))) * m_rotation;
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::rotate(const vec3 & eulerAngles)
@@ -348,6 +356,7 @@ void GameObject::rotate(const vec3 & eulerAngles)
 	m_rotation = quat(math::radians(eulerAngles)) * m_rotation;
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::rotate(const quat & rotation)
@@ -355,6 +364,7 @@ void GameObject::rotate(const quat & rotation)
 	m_rotation = rotation * m_rotation;
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setRotation(float x, float y, float z)
@@ -362,6 +372,7 @@ void GameObject::setRotation(float x, float y, float z)
 	m_rotation = quat(vec3(math::radians(x), math::radians(y), math::radians(z)));
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setRotation(const vec3 & eulerAngles)
@@ -369,6 +380,7 @@ void GameObject::setRotation(const vec3 & eulerAngles)
 	m_rotation = quat(math::radians(eulerAngles));
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setRotation(const quat & rotation)
@@ -376,6 +388,7 @@ void GameObject::setRotation(const quat & rotation)
 	m_rotation = rotation;
 	m_rotation = glm::normalize(m_rotation);
 	m_rotationChanged = true;
+	m_isTransformDirty = true;
 }
 
 quat GameObject::getRotation() const
@@ -392,36 +405,42 @@ void GameObject::scale(float s)
 {
 	m_scale *= s;
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::scale(float x, float y, float z)
 {
 	m_scale *= vec3(x, y, z);
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::scale(const vec3 & s)
 {
 	m_scale *= s;
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setScale(float s)
 {
 	m_scale = vec3(s, s, s);
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setScale(float x, float y, float z)
 {
 	m_scale = vec3(x, y, z);
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 void GameObject::setScale(const vec3 & s)
 {
 	m_scale = s;
 	m_scaleChanged = true;
+	m_isTransformDirty = true;
 }
 
 vec3 GameObject::getScale() const
@@ -450,11 +469,20 @@ vec3 GameObject::getDirectionUp() const
 	return m_directionUp;
 }
 
+GameObject * GameObject::getLinked(uint32_t HierarchyNode::* link) const
+{
+	if (m_manager == nullptr) {
+		return nullptr;
+	}
+
+	const uint32_t index = m_manager->m_gameObjects.getNode(m_id.getIndex()).*link;
+	return index != BasePool::INVALID_INDEX ? m_manager->m_gameObjects.get(index) : nullptr;
+}
+
 void GameObject::updatePosition() const
 {
 	if (m_positionChanged) {
 		m_positionMatrix = glm::translate(mat4(1.0f), m_position);
-		m_positionMatrixInversed = glm::translate(mat4(1.0f), -m_position);
 
 		m_positionChanged = false;
 		m_transformationChanged = true;
@@ -465,7 +493,6 @@ void GameObject::updateRotation() const
 {
 	if (m_rotationChanged) {
 		m_rotationMatrix = glm::mat4_cast(m_rotation);
-		m_rotationMatrixInversed = glm::inverse(m_rotationMatrix);
 
 		// update direction also
 		vec4 temp(0.0f, 0.0f, -1.0f, 1.0f);
@@ -486,8 +513,6 @@ void GameObject::updateScale() const
 {
 	if (m_scaleChanged) {
 		m_scaleMatrix = glm::scale(mat4(1.0f), m_scale);
-		m_scaleMatrixInversed = glm::scale(mat4(1.0f),
-			vec3(1.0f / m_scale.x, 1.0f / m_scale.y, 1.0f / m_scale.z));
 
 		m_scaleChanged = false;
 		m_transformationChanged = true;
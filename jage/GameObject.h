@@ -18,11 +18,14 @@ public:
 	virtual void setActive(bool active);
 	bool isActive() const;
 
+	// Names and tags are interned, objects are compared by their ids
 	void setName(const std::string& name);
-	std::string getName() const;
+	const std::string& getName() const;
+	StringId getNameId() const;
 
 	void setTag(const std::string& tag);
-	std::string getTag() const;
+	const std::string& getTag() const;
+	StringId getTagId() const;
 
 
 	const EntityManager* getEntityManager() const;
@@ -34,18 +37,23 @@ public:
 	// Tree structure functions
 	std::shared_ptr<GameObject> clone();
 
+	// Moves object to the end of children of parent, nullptr makes it root
 	void setParent(GameObject* parent);
 	GameObject* getParent() const;
+
+	GameObject* getFirstChild() const;
+	GameObject* getNextSibling() const;
 	
 	void addChild(std::shared_ptr<GameObject> node);
 
-	GameObject* getChildByName(const std::string& name, bool deep = false);
+	GameObject* getChildByName(StringId name, bool deep = false);
 
-	void deleteChildByName(const std::string& name, bool deep = false);
+	// Destroys child with all its descendants
+	void deleteChildByName(StringId name, bool deep = false);
 
-	std::shared_ptr<GameObject> detachChildByName(const std::string& name, bool deep = false);
+	std::shared_ptr<GameObject> detachChildByName(StringId name, bool deep = false);
 
-	std::vector<std::shared_ptr<GameObject>>& getChildren();
+	std::vector<GameObject*> getChildren() const;
 
 	// Component functions
 	template<typename T, typename... Args>
@@ -170,23 +178,24 @@ public:
 	vec3 getDirectionUp() const;
 
 protected:
-	std::string m_name;
-	std::string m_tag;
+	StringId m_name;
+	StringId m_tag;
 
 	bool m_isActive;
 
-	GameObject* m_parent;
-	std::vector<std::shared_ptr<GameObject>> m_children;
-
 private:
 	friend class EntityManager;
+	friend class WorldSnapshot;
+	friend class Prefab;
+	friend class GameObjectPool;
+	friend class TransformSystem;
+
+	GameObject* getLinked(uint32_t HierarchyNode::* link) const;
 
 	void updatePosition() const;
 	void updateRotation() const;
 	void updateScale() const;
 
-	static std::shared_ptr<GameObject> create(EntityManager* manager, EntityId id);
-
 	EntityManager* m_manager;
 	EntityId m_id;
 
@@ -203,17 +212,15 @@ private:
 	mutable mat4 m_transformation;
 
 	mutable mat4 m_positionMatrix;
-	mutable mat4 m_positionMatrixInversed;
-
 	mutable mat4 m_rotationMatrix;
-	mutable mat4 m_rotationMatrixInversed;
-
 	mutable mat4 m_scaleMatrix;
-	mutable mat4 m_scaleMatrixInversed;
 
 	mutable bool m_positionChanged;
 	mutable bool m_rotationChanged;
 	mutable bool m_scaleChanged;
 
 	mutable bool m_transformationChanged;
+
+	// set when local transformation changes, reset by TransformSystem
+	bool m_isTransformDirty;
 };
\ No newline at end of file
@@ -0,0 +1,372 @@
+#include "GameObjectPool.h"
+
+#include <algorithm>
+
+#include "ChunkAllocator.h"
+#include "GameObject.h"
+
+namespace
+{
+	// Deleter of shared objects, slot goes back to storage with object
+	struct ObjectDeleter
+	{
+		std::shared_ptr<detail::GameObjectStorage> storage;
+
+		void operator()(GameObject* object) const
+		{
+			object->~GameObject();
+			storage->deallocate(object);
+		}
+	};
+}
+
+const size_t detail::GameObjectStorage::CHUNK_SIZE;
+
+detail::GameObjectStorage::~GameObjectStorage()
+{
+	for (auto chunk : m_chunks) {
+		AlignedChunkAllocator<>::deallocate(chunk, sizeof(GameObject) * CHUNK_SIZE);
+	}
+}
+
+void * detail::GameObjectStorage::allocate()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	if (m_freeSlots.empty()) {
+		addChunk();
+	}
+
+	void* slot = m_freeSlots.back();
+	m_freeSlots.pop_back();
+	return slot;
+}
+
+void detail::GameObjectStorage::allocateMany(size_t count, void ** slots)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	while (m_freeSlots.size() < count) {
+		addChunk();
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		slots[i] = m_freeSlots.back();
+		m_freeSlots.pop_back();
+	}
+}
+
+void detail::GameObjectStorage::deallocate(void * slot)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	m_freeSlots.push_back(slot);
+}
+
+void detail::GameObjectStorage::reserve(size_t count)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	while (m_chunks.size() * CHUNK_SIZE < count) {
+		addChunk();
+	}
+}
+
+size_t detail::GameObjectStorage::getCommittedBytes() const
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+
+	return m_chunks.size() * CHUNK_SIZE * sizeof(GameObject);
+}
+
+void detail::GameObjectStorage::addChunk()
+{
+	char* chunk = static_cast<char*>(AlignedChunkAllocator<>::allocate(sizeof(GameObject) * CHUNK_SIZE));
+	m_chunks.push_back(chunk);
+
+	// slots are taken from the back, so objects are placed in address order
+	for (size_t i = CHUNK_SIZE; i > 0; --i) {
+		m_freeSlots.push_back(chunk + (i - 1) * sizeof(GameObject));
+	}
+}
+
+
+GameObjectPool::GameObjectPool() :
+	m_storage(std::make_shared<detail::GameObjectStorage>())
+{
+}
+
+GameObjectPool::~GameObjectPool()
+{
+	clear();
+}
+
+GameObject * GameObjectPool::construct(EntityManager * manager, EntityId id)
+{
+	const uint32_t index = id.getIndex();
+	reserve(index + 1);
+	destroy(index);
+
+	GameObject* object = new(m_storage->allocate()) GameObject(manager, id);
+
+	m_objects[index] = object;
+	return object;
+}
+
+void GameObjectPool::constructMany(EntityManager * manager, const EntityId * ids, size_t count, GameObject ** objects)
+{
+	uint32_t end = 0;
+	for (size_t i = 0; i < count; ++i) {
+		end = std::max(end, ids[i].getIndex() + 1);
+	}
+	reserve(end);
+
+	m_storage->allocateMany(count, reinterpret_cast<void**>(objects));
+
+	for (size_t i = 0; i < count; ++i) {
+		objects[i] = new(objects[i]) GameObject(manager, ids[i]);
+		m_objects[ids[i].getIndex()] = objects[i];
+	}
+}
+
+void GameObjectPool::destroy(uint32_t index)
+{
+	if (get(index) == nullptr) {
+		return;
+	}
+
+	// other objects must not refer to destroyed one
+	release(index);
+	retire(index);
+}
+
+void GameObjectPool::clear()
+{
+	// all objects go away, so there is no need to unlink them
+	for (uint32_t index = 0; index < m_objects.size(); ++index) {
+		if (m_objects[index] != nullptr) {
+			retire(index);
+		}
+	}
+
+	std::fill(m_hierarchy.begin(), m_hierarchy.end(), HierarchyNode());
+	m_names.clear();
+}
+
+void GameObjectPool::reserve(size_t count)
+{
+	m_storage->reserve(count);
+
+	if (m_objects.size() < count) {
+		m_objects.resize(count, nullptr);
+		m_hierarchy.resize(count);
+
+		std::lock_guard<std::mutex> lock(m_ownersMutex);
+		const size_t capacity = m_owners.capacity();
+		m_owners.resize(count);
+
+		if (m_owners.capacity() != capacity) {
+			auto hasOwner = std::make_unique<std::atomic<bool>[]>(m_owners.capacity());
+			for (size_t i = 0; i < capacity; ++i) {
+				hasOwner[i].store(m_hasOwner[i].load(std::memory_order_relaxed), std::memory_order_relaxed);
+			}
+			m_hasOwner = std::move(hasOwner);
+		}
+	}
+}
+
+void GameObjectPool::link(uint32_t index, uint32_t parent)
+{
+	detach(index);
+
+	if (parent == BasePool::INVALID_INDEX) {
+		return;
+	}
+
+	HierarchyNode& node = m_hierarchy[index];
+	HierarchyNode& parentNode = m_hierarchy[parent];
+
+	node.parent = parent;
+	node.previousSibling = parentNode.lastChild;
+	if (parentNode.lastChild != BasePool::INVALID_INDEX) {
+		m_hierarchy[parentNode.lastChild].nextSibling = index;
+	}
+	else {
+		parentNode.firstChild = index;
+	}
+	parentNode.lastChild = index;
+}
+
+void GameObjectPool::unlink(uint32_t index)
+{
+	if (index >= m_hierarchy.size()) {
+		return;
+	}
+
+	detach(index);
+
+	HierarchyNode& node = m_hierarchy[index];
+	for (uint32_t child = node.firstChild; child != BasePool::INVALID_INDEX;) {
+		HierarchyNode& childNode = m_hierarchy[child];
+		child = childNode.nextSibling;
+
+		childNode.parent = BasePool::INVALID_INDEX;
+		childNode.previousSibling = BasePool::INVALID_INDEX;
+		childNode.nextSibling = BasePool::INVALID_INDEX;
+	}
+	node.firstChild = BasePool::INVALID_INDEX;
+	node.lastChild = BasePool::INVALID_INDEX;
+}
+
+void GameObjectPool::release(uint32_t index)
+{
+	unlink(index);
+	removeName(index);
+}
+
+void GameObjectPool::setName(uint32_t index, StringId name)
+{
+	GameObject* object = get(index);
+	if (object == nullptr) {
+		return;
+	}
+
+	removeName(index);
+
+	object->m_name = name;
+	if (name != StringId()) {
+		m_names.emplace(name, index);
+	}
+}
+
+GameObject * GameObjectPool::find(StringId name) const
+{
+	auto it = m_names.find(name);
+	return it != m_names.end() ? get(it->second) : nullptr;
+}
+
+const HierarchyNode & GameObjectPool::getNode(uint32_t index) const
+{
+	return m_hierarchy[index];
+}
+
+void GameObjectPool::setNode(uint32_t index, const HierarchyNode & node)
+{
+	m_hierarchy[index] = node;
+}
+
+uint32_t GameObjectPool::getNextInSubtree(uint32_t index, uint32_t root) const
+{
+	if (m_hierarchy[index].firstChild != BasePool::INVALID_INDEX) {
+		return m_hierarchy[index].firstChild;
+	}
+
+	// climbs until some ancestor has next sibling
+	while (index != root) {
+		const HierarchyNode& node = m_hierarchy[index];
+		if (node.nextSibling != BasePool::INVALID_INDEX) {
+			return node.nextSibling;
+		}
+		index = node.parent;
+	}
+
+	return BasePool::INVALID_INDEX;
+}
+
+void GameObjectPool::detach(uint32_t index)
+{
+	HierarchyNode& node = m_hierarchy[index];
+	if (node.parent == BasePool::INVALID_INDEX) {
+		return;
+	}
+
+	HierarchyNode& parentNode = m_hierarchy[node.parent];
+	if (node.previousSibling != BasePool::INVALID_INDEX) {
+		m_hierarchy[node.previousSibling].nextSibling = node.nextSibling;
+	}
+	else {
+		parentNode.firstChild = node.nextSibling;
+	}
+
+	if (node.nextSibling != BasePool::INVALID_INDEX) {
+		m_hierarchy[node.nextSibling].previousSibling = node.previousSibling;
+	}
+	else {
+		parentNode.lastChild = node.previousSibling;
+	}
+
+	node.parent = BasePool::INVALID_INDEX;
+	node.previousSibling = BasePool::INVALID_INDEX;
+	node.nextSibling = BasePool::INVALID_INDEX;
+}
+
+void GameObjectPool::removeName(uint32_t index)
+{
+	GameObject* object = get(index);
+	if (object == nullptr) {
+		return;
+	}
+
+	auto range = m_names.equal_range(object->m_name);
+	for (auto it = range.first; it != range.second; ++it) {
+		if (it->second == index) {
+			m_names.erase(it);
+			break;
+		}
+	}
+}
+
+GameObject * GameObjectPool::get(uint32_t index) const
+{
+	return index < m_objects.size() ? m_objects[index] : nullptr;
+}
+
+std::shared_ptr<GameObject> GameObjectPool::share(uint32_t index) const
+{
+	GameObject* object = get(index);
+	if (object == nullptr) {
+		return nullptr;
+	}
+
+	// pool keeps the first owner while object belongs to its index
+	if (m_hasOwner[index].load(std::memory_order_acquire)) {
+		return m_owners[index];
+	}
+
+	std::lock_guard<std::mutex> lock(m_ownersMutex);
+
+	std::shared_ptr<GameObject>& owner = m_owners[index];
+	if (owner == nullptr) {
+		owner = std::shared_ptr<GameObject>(object, ObjectDeleter{ m_storage });
+		m_hasOwner[index].store(true, std::memory_order_release);
+	}
+	return owner;
+}
+
+size_t GameObjectPool::getCommittedBytes() const
+{
+	return m_storage->getCommittedBytes();
+}
+
+void GameObjectPool::retire(uint32_t index)
+{
+	GameObject* object = m_objects[index];
+	m_objects[index] = nullptr;
+
+	std::shared_ptr<GameObject> owner;
+	{
+		std::lock_guard<std::mutex> lock(m_ownersMutex);
+		owner.swap(m_owners[index]);
+		m_hasOwner[index].store(false, std::memory_order_relaxed);
+	}
+
+	if (owner == nullptr) {
+		object->~GameObject();
+		m_storage->deallocate(object);
+		return;
+	}
+
+	// object can't refer to index of another entity anymore, it is
+	// destroyed by deleter when its last owner goes away, maybe right here
+	object->invalidate();
+}
\ No newline at end of file
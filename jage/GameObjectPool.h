@@ -0,0 +1,160 @@
+#pragma once
+
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <mutex>
+
+#include "StringId.h"
+#include "Pool.h"
+
+class GameObject;
+class EntityManager;
+class EntityId;
+
+// Links of object in hierarchy, entity indices or INVALID_INDEX
+// Children of object form doubly linked list, so object can be
+// attached and detached in constant time
+struct HierarchyNode
+{
+	uint32_t parent = BasePool::INVALID_INDEX;
+	uint32_t firstChild = BasePool::INVALID_INDEX;
+	uint32_t lastChild = BasePool::INVALID_INDEX;
+	uint32_t previousSibling = BasePool::INVALID_INDEX;
+	uint32_t nextSibling = BasePool::INVALID_INDEX;
+};
+
+namespace detail
+{
+	// Chunks with slots for game objects
+	// Storage is shared with owners of objects, so objects which are still
+	// referenced can outlive pool. Slots are released from any thread
+	class GameObjectStorage
+	{
+	public:
+		static const size_t CHUNK_SIZE = 256;
+
+		GameObjectStorage() = default;
+		~GameObjectStorage();
+
+		GameObjectStorage(const GameObjectStorage&) = delete;
+		GameObjectStorage& operator=(const GameObjectStorage&) = delete;
+
+		// Returns uninitialized memory for one object
+		void* allocate();
+
+		// Fills slots with uninitialized memory for count objects
+		void allocateMany(size_t count, void** slots);
+
+		// Returns slot of destroyed object
+		void deallocate(void* slot);
+
+		// Makes room for count objects in total
+		void reserve(size_t count);
+
+		size_t getCommittedBytes() const;
+
+	private:
+		void addChunk();
+
+		mutable std::mutex m_mutex;
+		std::vector<void*> m_chunks;
+		std::vector<void*> m_freeSlots;
+	};
+}
+
+
+// Storage of game objects indexed by entity index
+// Objects are constructed in place inside chunks, so their addresses are
+// stable and entities don't allocate them one by one
+// Shared pointers own objects. Control block is created only when object
+// is shared for the first time. Object of destroyed entity stays until
+// its index is reused, then it is destroyed or, if it is still shared,
+// invalidated and left to its owners, so pointers never switch to
+// another object
+// Hierarchy links of objects are stored separately in contiguous array
+// Objects are indexed by their names
+class GameObjectPool
+{
+public:
+	GameObjectPool();
+	~GameObjectPool();
+
+	GameObjectPool(const GameObjectPool&) = delete;
+	GameObjectPool& operator=(const GameObjectPool&) = delete;
+
+	// Constructs object of entity instead of previous object with its index
+	GameObject* construct(EntityManager* manager, EntityId id);
+
+	// Constructs objects of several entities which don't have them yet
+	// Objects are written to objects in the order of ids
+	void constructMany(EntityManager* manager, const EntityId* ids, size_t count, GameObject** objects);
+
+	// Removes object and unlinks it from its parent and children
+	// Object is destroyed now or, if it is shared, with its last owner
+	void destroy(uint32_t index);
+
+	// Makes object the last child of parent, INVALID_INDEX makes it root
+	void link(uint32_t index, uint32_t parent);
+
+	// Detaches object from its parent and its children from it
+	void unlink(uint32_t index);
+
+	// Unlinks object of destroyed entity and removes it from name index
+	// Object itself stays until its index is reused
+	void release(uint32_t index);
+
+	void setName(uint32_t index, StringId name);
+
+	// Returns some object with specified name or nullptr
+	GameObject* find(StringId name) const;
+
+	const HierarchyNode& getNode(uint32_t index) const;
+
+	// Replaces links of object as is, so links of all objects
+	// can be restored at once. Linked objects must be set as well
+	void setNode(uint32_t index, const HierarchyNode& node);
+
+	// Returns next object after specified one in depth first order of
+	// subtree of root, INVALID_INDEX when subtree ends
+	uint32_t getNextInSubtree(uint32_t index, uint32_t root) const;
+
+	void clear();
+
+	// Makes room for objects with indices less than count
+	void reserve(size_t count);
+
+	// Returns nullptr if there is no object with specified index
+	GameObject* get(uint32_t index) const;
+
+	// Returns pointer which shares ownership of object
+	// Pointer is valid after entity is destroyed, but object is invalidated
+	// when its index is reused
+	std::shared_ptr<GameObject> share(uint32_t index) const;
+
+	size_t getCommittedBytes() const;
+
+private:
+	void detach(uint32_t index);
+	void removeName(uint32_t index);
+
+	// Destroys object of index or hands it over to its owners
+	void retire(uint32_t index);
+
+	std::shared_ptr<detail::GameObjectStorage> m_storage;
+
+	std::vector<GameObject*> m_objects;
+
+	// owners are created by share, which can be called from several threads
+	// Flag of index is set after its owner is created, then the owner
+	// is copied without lock
+	mutable std::mutex m_ownersMutex;
+	mutable std::vector<std::shared_ptr<GameObject>> m_owners;
+	std::unique_ptr<std::atomic<bool>[]> m_hasOwner;
+
+	std::vector<HierarchyNode> m_hierarchy;
+	std::unordered_multimap<StringId, uint32_t> m_names;
+};
\ No newline at end of file
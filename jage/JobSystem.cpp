@@ -0,0 +1,233 @@
+#include "JobSystem.h"
+
+std::vector<std::unique_ptr<JobSystem::Worker>> JobSystem::m_workers;
+std::vector<std::thread> JobSystem::m_threads;
+
+std::atomic<bool> JobSystem::m_isRunning(false);
+std::atomic<size_t> JobSystem::m_jobCount(0);
+
+std::mutex JobSystem::m_sleepMutex;
+std::condition_variable JobSystem::m_wakeCondition;
+
+thread_local size_t JobSystem::m_workerIndex = 0;
+
+void JobSystem::init(size_t workerCount)
+{
+	if (m_isRunning) {
+		return;
+	}
+
+	if (workerCount == 0) {
+		size_t hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	// first worker belongs to the calling thread
+	m_workers.clear();
+	for (size_t i = 0; i < workerCount + 1; ++i) {
+		m_workers.emplace_back(std::make_unique<Worker>());
+	}
+
+	m_workerIndex = 0;
+	m_jobCount = 0;
+	m_isRunning = true;
+
+	for (size_t i = 1; i < m_workers.size(); ++i) {
+		m_threads.emplace_back(&JobSystem::workerLoop, i);
+	}
+}
+
+void JobSystem::close()
+{
+	if (!m_isRunning) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		m_isRunning = false;
+	}
+	m_wakeCondition.notify_all();
+
+	for (auto& thread : m_threads) {
+		thread.join();
+	}
+
+	// jobs left in deques are executed here, otherwise their
+	// counters never reach zero and waiting threads spin forever
+	while (executeNext()) {}
+
+	m_threads.clear();
+	m_workers.clear();
+	m_jobCount = 0;
+}
+
+void JobSystem::run(Job job, JobCounter * counter)
+{
+	if (counter != nullptr) {
+		++counter->m_value;
+	}
+
+	if (!m_isRunning) {
+		job();
+		finish(counter);
+		return;
+	}
+
+	schedule(Entry{ std::move(job), counter });
+}
+
+void JobSystem::run(Job job, JobCounter * counter, JobCounter & dependency)
+{
+	if (counter != nullptr) {
+		++counter->m_value;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(dependency.m_mutex);
+		if (dependency.m_value.load() != 0) {
+			dependency.m_waitingJobs.push_back(JobCounter::WaitingJob{ std::move(job), counter });
+			return;
+		}
+	}
+
+	if (!m_isRunning) {
+		job();
+		finish(counter);
+		return;
+	}
+
+	schedule(Entry{ std::move(job), counter });
+}
+
+void JobSystem::wait(JobCounter & counter)
+{
+	while (!counter.isDone()) {
+		if (!executeNext()) {
+			std::this_thread::yield();
+		}
+	}
+
+	// last job may still hold the lock, so counter can't be destroyed yet
+	std::lock_guard<std::mutex> lock(counter.m_mutex);
+}
+
+size_t JobSystem::getThreadCount()
+{
+	return m_isRunning ? m_workers.size() : 1;
+}
+
+bool JobSystem::isInitialized()
+{
+	return m_isRunning;
+}
+
+void JobSystem::schedule(Entry entry)
+{
+	// counter is incremented before job is published, so
+	// thief can't decrement it first and wrap it around
+	{
+		std::lock_guard<std::mutex> lock(m_sleepMutex);
+		++m_jobCount;
+	}
+
+	Worker* worker = m_workers[m_workerIndex < m_workers.size() ? m_workerIndex : 0].get();
+	{
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		worker->jobs.push_back(std::move(entry));
+	}
+
+	m_wakeCondition.notify_one();
+}
+
+bool JobSystem::executeNext()
+{
+	if (m_jobCount.load() == 0) {
+		return false;
+	}
+
+	Entry entry;
+	bool found = false;
+
+	const size_t workerCount = m_workers.size();
+	const size_t ownIndex = m_workerIndex < workerCount ? m_workerIndex : 0;
+
+	// own jobs are taken from the back, others are stolen from the front
+	for (size_t i = 0; i < workerCount && !found; ++i) {
+		Worker* worker = m_workers[(ownIndex + i) % workerCount].get();
+
+		std::lock_guard<std::mutex> lock(worker->mutex);
+		if (worker->jobs.empty()) {
+			continue;
+		}
+
+		if (i == 0) {
+			entry = std::move(worker->jobs.back());
+			worker->jobs.pop_back();
+		}
+		else {
+			entry = std::move(worker->jobs.front());
+			worker->jobs.pop_front();
+		}
+		found = true;
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	--m_jobCount;
+
+	entry.job();
+	finish(entry.counter);
+
+	return true;
+}
+
+void JobSystem::finish(JobCounter * counter)
+{
+	if (counter == nullptr) {
+		return;
+	}
+
+	size_t value = counter->m_value.load();
+	while (value > 1) {
+		if (counter->m_value.compare_exchange_weak(value, value - 1)) {
+			return;
+		}
+	}
+
+	// counter reaches zero only under the lock so dependent jobs are not lost
+	std::vector<JobCounter::WaitingJob> waitingJobs;
+	{
+		std::lock_guard<std::mutex> lock(counter->m_mutex);
+		--counter->m_value;
+		waitingJobs.swap(counter->m_waitingJobs);
+	}
+
+	for (auto& waitingJob : waitingJobs) {
+		if (m_isRunning) {
+			schedule(Entry{ std::move(waitingJob.job), waitingJob.counter });
+		}
+		else {
+			waitingJob.job();
+			finish(waitingJob.counter);
+		}
+	}
+}
+
+void JobSystem::workerLoop(size_t index)
+{
+	m_workerIndex = index;
+
+	while (m_isRunning) {
+		if (executeNext()) {
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_sleepMutex);
+		m_wakeCondition.wait(lock, []() {
+			return m_jobCount.load() > 0 || !m_isRunning;
+		});
+	}
+}
\ No newline at end of file
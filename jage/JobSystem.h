@@ -0,0 +1,127 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+class JobSystem;
+
+// Number of unfinished jobs
+// Jobs can be scheduled to start after counter reaches zero
+class JobCounter
+{
+public:
+	JobCounter() : m_value(0) {}
+
+	JobCounter(const JobCounter&) = delete;
+	JobCounter& operator=(const JobCounter&) = delete;
+
+	bool isDone() const { return m_value.load() == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct WaitingJob
+	{
+		std::function<void()> job;
+		JobCounter* counter;
+	};
+
+	std::atomic<size_t> m_value;
+
+	std::mutex m_mutex;
+	std::vector<WaitingJob> m_waitingJobs;
+};
+
+
+// Pool of worker threads with work stealing
+// Each worker has its own deque: owner takes jobs from the back,
+// idle workers steal from the front of other deques.
+// Thread which called init participates only while it is waiting
+class JobSystem
+{
+public:
+	typedef std::function<void()> Job;
+
+	// Starts worker threads
+	// 0 - one worker per hardware thread except the calling one
+	static void init(size_t workerCount = 0);
+
+	// Finishes worker threads, jobs which were not started
+	// are executed on the calling thread
+	static void close();
+
+	// Schedules job. If counter is specified, it is incremented now
+	// and decremented when job is finished
+	// Without initialized workers job is executed immediately
+	static void run(Job job, JobCounter* counter = nullptr);
+
+	// Schedules job after dependency counter reaches zero
+	static void run(Job job, JobCounter* counter, JobCounter& dependency);
+
+	// Executes pending jobs on the calling thread until counter reaches zero
+	static void wait(JobCounter& counter);
+
+	// Calls func(begin, end) for ranges of [0, count) split by grainSize
+	// Returns when all ranges are processed, calling thread takes part
+	template<typename Func>
+	static void parallelFor(size_t count, size_t grainSize, Func&& func)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		grainSize = std::max<size_t>(grainSize, 1);
+
+		JobCounter counter;
+		for (size_t begin = grainSize; begin < count; begin += grainSize) {
+			const size_t end = std::min(count, begin + grainSize);
+			run([&func, begin, end]() { func(begin, end); }, &counter);
+		}
+
+		func(0, std::min(count, grainSize));
+
+		wait(counter);
+	}
+
+	// Returns number of threads which execute jobs including the calling one
+	static size_t getThreadCount();
+
+	static bool isInitialized();
+
+private:
+	struct Entry
+	{
+		Job job;
+		JobCounter* counter;
+	};
+
+	struct Worker
+	{
+		std::mutex mutex;
+		std::deque<Entry> jobs;
+	};
+
+	static void schedule(Entry entry);
+	static bool executeNext();
+	static void finish(JobCounter* counter);
+
+	static void workerLoop(size_t index);
+
+	static std::vector<std::unique_ptr<Worker>> m_workers;
+	static std::vector<std::thread> m_threads;
+
+	static std::atomic<bool> m_isRunning;
+	static std::atomic<size_t> m_jobCount;
+
+	static std::mutex m_sleepMutex;
+	static std::condition_variable m_wakeCondition;
+
+	static thread_local size_t m_workerIndex;
+};
\ No newline at end of file
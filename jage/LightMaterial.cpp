@@ -32,7 +32,7 @@ LightMaterial::~LightMaterial()
 {
 }
 
-void LightMaterial::bind()
+void LightMaterial::bind() const
 {
 	m_shader->bind();
 
@@ -8,7 +8,7 @@ public:
 	LightMaterial();
 	~LightMaterial();
 
-	void bind() override;
+	void bind() const override;
 
 	int getAlbedoTextureUnit() const;
 	int getNormalsTextureUnit() const;
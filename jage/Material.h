@@ -20,7 +20,7 @@ public:
 	Material(Type type, const std::type_index& classInfo);
 	virtual ~Material();
 
-	virtual void bind() = 0;
+	virtual void bind() const = 0;
 
 	Shader* getShader() const;
 
@@ -71,6 +71,12 @@ public:
 		return dynamic_cast<T*>(this);
 	}
 
+	template<typename T>
+	const T* as() const
+	{
+		return dynamic_cast<const T*>(this);
+	}
+
 protected:
 	Shader* m_shader;
 
@@ -31,6 +31,7 @@ void Mesh::init(const MeshGeometry& geometry)
 	size_t positionsBufferSize = 0;
 	if (geometry.vertexComponents & MeshGeometry::POSITIONS) {
 		m_vertexCount = static_cast<unsigned int>(geometry.positions.size());
+		m_bounds = BoundingVolume::fromPoints(geometry.positions);
 		positionsBufferSize = sizeof(vec3) * m_vertexCount;
 		bufferSize += positionsBufferSize;
 		++m_attributeCount;
@@ -125,4 +126,9 @@ unsigned int Mesh::getVertexCount() const
 unsigned int Mesh::getAttributeCount() const
 {
 	return m_attributeCount;
+}
+
+const BoundingVolume & Mesh::getBounds() const
+{
+	return m_bounds;
 }
\ No newline at end of file
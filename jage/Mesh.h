@@ -7,6 +7,7 @@
 #include <GL/glew.h>
 
 #include "MeshGeometry.h"
+#include "BoundingVolume.h"
 
 class Mesh
 {
@@ -22,6 +23,10 @@ public:
 	unsigned int getVertexCount() const;
 	unsigned int getAttributeCount() const;
 
+	// Local space bounds of vertex positions, they are calculated
+	// in init because geometry is not kept after upload
+	const BoundingVolume& getBounds() const;
+
 private:
 	GLuint m_VAO;
 	GLuint m_VBO;
@@ -33,5 +38,7 @@ private:
 
 	GLenum m_topology;
 
+	BoundingVolume m_bounds;
+
 	bool m_initialized;
 };
\ No newline at end of file
@@ -26,3 +26,13 @@ Material* MeshComponent::getMaterial()
 {
 	return m_material.get();
 }
+
+const Material* MeshComponent::getMaterial() const
+{
+	return m_material.get();
+}
+
+bool MeshComponent::operator==(const MeshComponent & other) const
+{
+	return m_mesh == other.m_mesh && m_material == other.m_material;
+}
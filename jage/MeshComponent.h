@@ -1,5 +1,7 @@
 #pragma once
 
+#include <functional>
+
 #include "MeshMaterial.h"
 #include "Mesh.h"
 
@@ -11,10 +13,28 @@ public:
 	void setMesh(Mesh* mesh);
 	Mesh* getMesh() const;
 
+	// Shared components refer to one material from all their entities,
+	// so it can't be changed through them. Assign another material instead
 	void setMaterial(std::shared_ptr<Material> material);
 	Material* getMaterial();
+	const Material* getMaterial() const;
+
+	// Components are equal if they have the same mesh and material objects
+	bool operator==(const MeshComponent& other) const;
 
 private:
 	Mesh* m_mesh;
 	std::shared_ptr<Material> m_material;
-};
\ No newline at end of file
+};
+
+namespace std
+{
+	template<>
+	struct hash<MeshComponent>
+	{
+		size_t operator()(const MeshComponent& component) const
+		{
+			return hash<Mesh*>()(component.getMesh()) ^ (hash<const Material*>()(component.getMaterial()) << 1);
+		}
+	};
+}
\ No newline at end of file
@@ -25,7 +25,7 @@ MeshMaterial::MeshMaterial(Texture* albedoTexture, Texture* normalsTexture) :
 	setNormalsTexture(normalsTexture);
 }
 
-void MeshMaterial::bind()
+void MeshMaterial::bind() const
 {
 	m_shader->bind();
 
@@ -7,7 +7,7 @@ class MeshMaterial : public Material
 public:
 	MeshMaterial(Texture* albedoTexture = nullptr, Texture* normalsTexture = nullptr);
 
-	void bind() override;
+	void bind() const override;
 
 	void setAlbedoTexture(Texture* texture);
 	Texture* getAlbedoTexture() const;
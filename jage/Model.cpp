@@ -31,7 +31,8 @@ std::shared_ptr<GameObject> Model::createGameObject(EntityManager * manager, con
 		gameObject->setTransformationMatrix(modelNode->localTransformation);
 
 		if (modelNode->mesh != nullptr) {
-			gameObject->assign<MeshComponent>(modelNode->mesh, std::make_shared<MeshMaterial>(*modelNode->material));
+			gameObject->assign<Shared<MeshComponent>>(modelNode->mesh, modelNode->material);
+			gameObject->assign<BoundsComponent>(modelNode->mesh->getBounds());
 		}
 
 		for (size_t i = 0; i < modelNode->children.size(); ++i) {
@@ -45,3 +46,8 @@ std::shared_ptr<GameObject> Model::createGameObject(EntityManager * manager, con
 
 	return modelRoot;
 }
+
+const BoundingVolume & Model::getBounds() const
+{
+	return m_bounds;
+}
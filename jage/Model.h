@@ -6,6 +6,7 @@
 #include "Mesh.h"
 
 #include "MeshComponent.h"
+#include "BoundsComponent.h"
 
 class Model
 {
@@ -13,6 +14,9 @@ public:
 	Model();
 
 	std::shared_ptr<GameObject> createGameObject(EntityManager* manager, const std::string& name);
+
+	// Bounds of all meshes in model space
+	const BoundingVolume& getBounds() const;
 	
 private:
 	friend class ModelFactory;
@@ -29,12 +33,15 @@ private:
 
 		mat4 localTransformation;
 		Mesh* mesh;
-		MeshMaterial* material;
+		std::shared_ptr<MeshMaterial> material;
 	};
 
 	Node m_rootNode;
 	std::vector<Node*> m_nodes;
 
 	std::vector<Mesh> m_meshes;
-	std::vector<MeshMaterial> m_materials;
+	// materials are shared by all instances of model
+	std::vector<std::shared_ptr<MeshMaterial>> m_materials;
+
+	BoundingVolume m_bounds;
 };
\ No newline at end of file
@@ -54,6 +54,8 @@ void * ModelFactory::load()
 
 		model->m_materials.resize(scene->mNumMaterials);
 		for (size_t i = 0; i < scene->mNumMaterials; ++i) {
+			model->m_materials[i] = std::make_shared<MeshMaterial>();
+
 			const aiMaterial* materialData = scene->mMaterials[i];
 
 			Texture* albedoTexture = nullptr;
@@ -101,8 +103,8 @@ void * ModelFactory::load()
 				normalsTexture = ResourceManager::get<Texture>("default_normals");
 			}
 
-			model->m_materials[i].setAlbedoTexture(albedoTexture);
-			model->m_materials[i].setNormalsTexture(normalsTexture);
+			model->m_materials[i]->setAlbedoTexture(albedoTexture);
+			model->m_materials[i]->setNormalsTexture(normalsTexture);
 		}
 
 		// Loading meshes
@@ -157,6 +159,10 @@ void * ModelFactory::load()
 		std::stack<Model::Node*> nodes;		
 		nodes.push(&model->m_rootNode);
 
+		// model space transformation of each node, used for model bounds
+		std::stack<mat4> transformations;
+		transformations.push(mat4(1.0f));
+
 		while (!modelTree.empty()) {
 			aiNode* nodeData = modelTree.top();
 			modelTree.pop();
@@ -167,10 +173,14 @@ void * ModelFactory::load()
 			modelNode->name = nodeData->mName.C_Str();
 			modelNode->localTransformation = toGLM(nodeData->mTransformation);
 
+			const mat4 transformation = transformations.top() * modelNode->localTransformation;
+			transformations.pop();
+
 			modelNode->children.resize(nodeData->mNumChildren + nodeData->mNumMeshes);
 			for (size_t i = 0; i < nodeData->mNumChildren; ++i) {
 				modelTree.push(nodeData->mChildren[i]);
 				nodes.push(&modelNode->children[i]);
+				transformations.push(transformation);
 			}
 
 			for (size_t i = 0; i < nodeData->mNumMeshes; ++i) {
@@ -180,7 +190,9 @@ void * ModelFactory::load()
 
 				childModelNode->name = meshData->mName.C_Str();
 				childModelNode->mesh = &model->m_meshes[nodeData->mMeshes[i]];
-				childModelNode->material = &model->m_materials[meshData->mMaterialIndex];
+				childModelNode->material = model->m_materials[meshData->mMaterialIndex];
+
+				model->m_bounds.merge(childModelNode->mesh->getBounds().transformed(transformation));
 			}
 		}
 
@@ -1,57 +1,256 @@
 #include "Pool.h"
 
-BasePool::BasePool(size_t elementSize, size_t chunkSize) :
-	m_elementSize(elementSize), m_chunkSize(chunkSize), m_size(0), m_capacity(0)
+#include <algorithm>
+#include <numeric>
+#include <cstring>
+
+const uint32_t BasePool::INVALID_INDEX;
+
+BasePool::BasePool(size_t elementSize, size_t chunkSize, ChunkAllocatorFunctions allocator) :
+	m_elementSize(elementSize), m_chunkSize(chunkSize), m_capacity(0), m_isSorted(true), m_allocator(allocator)
 {
 }
 
 BasePool::~BasePool()
 {
 	for (auto chunk : m_chunks) {
-		delete[] chunk;
+		m_allocator.deallocate(chunk, m_elementSize * m_chunkSize);
 	}
 }
 
-void BasePool::expand(size_t n)
+void * BasePool::insert(uint32_t entityIndex, uint32_t version)
 {
-	if (n >= m_size) {
-		if (n >= m_capacity) {
-			reserve(n);
+	if (entityIndex >= m_sparse.size()) {
+		m_sparse.resize(entityIndex + 1, INVALID_INDEX);
+	}
+
+	uint32_t position = m_sparse[entityIndex];
+	if (position != INVALID_INDEX) {
+		destroyElement(position);
+		setVersions(position, version, version);
+		return at(position);
+	}
+
+	position = static_cast<uint32_t>(m_dense.size());
+	reserve(position + 1);
+
+	m_sparse[entityIndex] = position;
+	if (!m_dense.empty() && m_dense.back() > entityIndex) {
+		m_isSorted = false;
+	}
+	m_dense.push_back(entityIndex);
+	m_changeVersions.push_back(0);
+	m_addVersions.push_back(0);
+	setVersions(position, version, version);
+
+	return at(position);
+}
+
+size_t BasePool::append(const uint32_t * entityIndices, size_t count, uint32_t version)
+{
+	const size_t begin = m_dense.size();
+	reserve(begin + count);
+
+	m_dense.insert(m_dense.end(), entityIndices, entityIndices + count);
+	m_changeVersions.resize(begin + count);
+	m_addVersions.resize(begin + count);
+
+	for (size_t i = begin; i < begin + count; ++i) {
+		const uint32_t entityIndex = m_dense[i];
+		if (entityIndex >= m_sparse.size()) {
+			m_sparse.resize(entityIndex + 1, INVALID_INDEX);
 		}
+		m_sparse[entityIndex] = static_cast<uint32_t>(i);
 
-		m_size = n;
+		if (i > 0 && m_dense[i - 1] > entityIndex) {
+			m_isSorted = false;
+		}
+		setVersions(i, version, version);
 	}
+
+	return begin;
+}
+
+void BasePool::erase(uint32_t entityIndex)
+{
+	if (!contains(entityIndex)) {
+		return;
+	}
+
+	uint32_t position = m_sparse[entityIndex];
+	uint32_t lastPosition = static_cast<uint32_t>(m_dense.size() - 1);
+
+	destroyElement(position);
+
+	if (position != lastPosition) {
+		uint32_t lastEntityIndex = m_dense[lastPosition];
+		moveElement(position, lastPosition);
+
+		m_dense[position] = lastEntityIndex;
+		m_sparse[lastEntityIndex] = position;
+		setVersions(position, m_changeVersions[lastPosition], m_addVersions[lastPosition]);
+		m_isSorted = false;
+	}
+
+	m_sparse[entityIndex] = INVALID_INDEX;
+	m_dense.pop_back();
+	m_changeVersions.pop_back();
+	m_addVersions.pop_back();
+
+	// spare chunk prevents reallocation when size goes back and forth
+	releaseChunks(1);
+}
+
+void BasePool::clear()
+{
+	for (size_t i = 0; i < m_dense.size(); ++i) {
+		destroyElement(i);
+		m_sparse[m_dense[i]] = INVALID_INDEX;
+	}
+	m_dense.clear();
+	m_changeVersions.clear();
+	m_addVersions.clear();
+	m_isSorted = true;
+
+	releaseChunks(0);
 }
 
 void BasePool::reserve(size_t n)
 {
 	while (m_capacity < n)
 	{
-		char* chunk = new char[m_elementSize * m_chunkSize];
+		char* chunk = static_cast<char*>(m_allocator.allocate(m_elementSize * m_chunkSize));
 		m_chunks.push_back(chunk);
+		m_chunkVersions.emplace_back();
 		m_capacity += m_chunkSize;
 	}
 }
 
-void * BasePool::get(size_t n)
+void BasePool::shrinkToFit()
+{
+	releaseChunks(0);
+}
+
+void BasePool::swap(size_t first, size_t second)
+{
+	if (first == second) {
+		return;
+	}
+
+	swapElements(first, second);
+	std::swap(m_dense[first], m_dense[second]);
+	m_sparse[m_dense[first]] = static_cast<uint32_t>(first);
+	m_sparse[m_dense[second]] = static_cast<uint32_t>(second);
+
+	const uint32_t changeVersion = m_changeVersions[first];
+	const uint32_t addVersion = m_addVersions[first];
+	setVersions(first, m_changeVersions[second], m_addVersions[second]);
+	setVersions(second, changeVersion, addVersion);
+
+	m_isSorted = false;
+}
+
+void BasePool::sortByEntityIndex()
 {
-	if (n < m_size) {
-		return m_chunks[n / m_chunkSize] + (n % m_chunkSize) * m_elementSize;
+	if (m_isSorted) {
+		return;
+	}
+
+	// order[i] is current position of element which must be at position i
+	std::vector<uint32_t> order(m_dense.size());
+	std::iota(order.begin(), order.end(), 0);
+	std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+		return m_dense[a] < m_dense[b];
+	});
+
+	// permutation is applied cycle by cycle, element which belongs to the
+	// start of cycle is carried along it by swaps
+	for (size_t i = 0; i < order.size(); ++i) {
+		size_t current = i;
+		while (order[current] != i) {
+			const size_t next = order[current];
+
+			swapElements(current, next);
+			std::swap(m_dense[current], m_dense[next]);
+			std::swap(m_changeVersions[current], m_changeVersions[next]);
+			std::swap(m_addVersions[current], m_addVersions[next]);
+
+			order[current] = static_cast<uint32_t>(current);
+			current = next;
+		}
+		order[current] = static_cast<uint32_t>(current);
+	}
+
+	for (size_t i = 0; i < m_dense.size(); ++i) {
+		m_sparse[m_dense[i]] = static_cast<uint32_t>(i);
+	}
+
+	// chunk versions are recalculated from their new elements
+	for (auto& versions : m_chunkVersions) {
+		versions.changed = 0;
+		versions.added = 0;
+	}
+	for (size_t i = 0; i < m_dense.size(); ++i) {
+		setVersions(i, m_changeVersions[i], m_addVersions[i]);
+	}
+
+	m_isSorted = true;
+}
+
+bool BasePool::isSorted() const
+{
+	return m_isSorted;
+}
+
+bool BasePool::contains(uint32_t entityIndex) const
+{
+	return entityIndex < m_sparse.size() && m_sparse[entityIndex] != INVALID_INDEX;
+}
+
+uint32_t BasePool::find(uint32_t entityIndex) const
+{
+	return entityIndex < m_sparse.size() ? m_sparse[entityIndex] : INVALID_INDEX;
+}
+
+void * BasePool::get(uint32_t entityIndex)
+{
+	if (contains(entityIndex)) {
+		return at(m_sparse[entityIndex]);
 	}
 	return nullptr;
 }
 
-const void * BasePool::get(size_t n) const
+const void * BasePool::get(uint32_t entityIndex) const
 {
-	if (n < m_size) {
-		return m_chunks[n / m_chunkSize] + (n % m_chunkSize) * m_elementSize;
+	if (contains(entityIndex)) {
+		return at(m_sparse[entityIndex]);
 	}
 	return nullptr;
 }
 
+void * BasePool::at(size_t n)
+{
+	return m_chunks[n / m_chunkSize] + (n % m_chunkSize) * m_elementSize;
+}
+
+const void * BasePool::at(size_t n) const
+{
+	return m_chunks[n / m_chunkSize] + (n % m_chunkSize) * m_elementSize;
+}
+
+uint32_t BasePool::getEntityIndex(size_t n) const
+{
+	return m_dense[n];
+}
+
+const std::vector<uint32_t>& BasePool::getEntityIndices() const
+{
+	return m_dense;
+}
+
 size_t BasePool::getSize() const
 {
-	return m_size;
+	return m_dense.size();
 }
 
 size_t BasePool::getCapacity() const
@@ -59,7 +258,84 @@ size_t BasePool::getCapacity() const
 	return m_capacity;
 }
 
+size_t BasePool::getElementSize() const
+{
+	return m_elementSize;
+}
+
+size_t BasePool::getChunkSize() const
+{
+	return m_chunkSize;
+}
+
 size_t BasePool::getChunkCount() const
 {
 	return m_chunks.size();
 }
+
+const char * BasePool::getChunk(size_t n) const
+{
+	return m_chunks[n];
+}
+
+void BasePool::assignChunks(const void * entityIndices, size_t count, const char * chunks, uint32_t version)
+{
+	clear();
+	reserve(count);
+
+	const size_t chunkBytes = m_elementSize * m_chunkSize;
+	for (size_t i = 0; i * m_chunkSize < count; ++i) {
+		std::memcpy(m_chunks[i], chunks + i * chunkBytes, chunkBytes);
+	}
+
+	m_dense.resize(count);
+	std::memcpy(m_dense.data(), entityIndices, count * sizeof(uint32_t));
+	m_changeVersions.resize(count);
+	m_addVersions.resize(count);
+
+	for (size_t i = 0; i < count; ++i) {
+		const uint32_t entityIndex = m_dense[i];
+		if (entityIndex >= m_sparse.size()) {
+			m_sparse.resize(entityIndex + 1, INVALID_INDEX);
+		}
+		m_sparse[entityIndex] = static_cast<uint32_t>(i);
+		setVersions(i, version, version);
+	}
+
+	m_isSorted = std::is_sorted(m_dense.begin(), m_dense.end());
+}
+
+size_t BasePool::getCommittedBytes() const
+{
+	return m_chunks.size() * m_chunkSize * m_elementSize;
+}
+
+size_t BasePool::getUsedBytes() const
+{
+	return m_dense.size() * m_elementSize;
+}
+
+void BasePool::setVersions(size_t n, uint32_t changeVersion, uint32_t addVersion)
+{
+	m_changeVersions[n] = changeVersion;
+	m_addVersions[n] = addVersion;
+
+	ChunkVersions& chunkVersions = m_chunkVersions[n / m_chunkSize];
+	if (chunkVersions.changed < changeVersion) {
+		chunkVersions.changed = changeVersion;
+	}
+	if (chunkVersions.added < addVersion) {
+		chunkVersions.added = addVersion;
+	}
+}
+
+void BasePool::releaseChunks(size_t spareCount)
+{
+	const size_t usedCount = (m_dense.size() + m_chunkSize - 1) / m_chunkSize;
+	while (m_chunks.size() > usedCount + spareCount) {
+		m_allocator.deallocate(m_chunks.back(), m_elementSize * m_chunkSize);
+		m_chunks.pop_back();
+		m_chunkVersions.pop_back();
+		m_capacity -= m_chunkSize;
+	}
+}
\ No newline at end of file
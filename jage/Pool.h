@@ -1,48 +1,300 @@
 #pragma once
 
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <atomic>
+#include <new>
 #include <vector>
 
+#include "ChunkAllocator.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace detail
+{
+	// Returns index of the lowest set bit, value must not be zero
+	inline uint32_t countTrailingZeros(uint64_t value)
+	{
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward64(&index, value);
+		return static_cast<uint32_t>(index);
+#else
+		return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+	}
+
+	// Returns the first word starting from specified one in which all bitmaps
+	// have common bits or wordCount if there is no such word
+	// Common bits of returned word are written to bits
+	// Words are compared 256 or 128 at a time when AVX2 or SSE2 is available
+	inline size_t findCommonBits(const std::vector<uint64_t>* const* bitmaps, size_t bitmapCount, 
+		size_t word, size_t wordCount, uint64_t& bits)
+	{
+#if defined(__AVX2__)
+		for (; word + 4 <= wordCount; word += 4) {
+			__m256i result = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(bitmaps[0]->data() + word));
+			for (size_t i = 1; i < bitmapCount; ++i) {
+				result = _mm256_and_si256(result, 
+					_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bitmaps[i]->data() + word)));
+			}
+
+			if (!_mm256_testz_si256(result, result)) {
+				break;
+			}
+		}
+#elif defined(__SSE2__) || defined(_M_X64)
+		const __m128i zero = _mm_setzero_si128();
+		for (; word + 2 <= wordCount; word += 2) {
+			__m128i result = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bitmaps[0]->data() + word));
+			for (size_t i = 1; i < bitmapCount; ++i) {
+				result = _mm_and_si128(result, 
+					_mm_loadu_si128(reinterpret_cast<const __m128i*>(bitmaps[i]->data() + word)));
+			}
+
+			if (_mm_movemask_epi8(_mm_cmpeq_epi8(result, zero)) != 0xFFFF) {
+				break;
+			}
+		}
+#endif
+
+		for (; word < wordCount; ++word) {
+			bits = (*bitmaps[0])[word];
+			for (size_t i = 1; i < bitmapCount && bits != 0; ++i) {
+				bits &= (*bitmaps[i])[word];
+			}
+
+			if (bits != 0) {
+				return word;
+			}
+		}
+
+		return wordCount;
+	}
+}
+
+// Sparse set of fixed size elements
+// Elements are densely packed in chunks, entity index is mapped to
+// dense position through sparse array
+// Each element has versions of its last change and insertion, each chunk
+// keeps the highest versions of its elements so chunks without recent
+// changes can be skipped entirely
+// Chunks are allocated by allocator policy, chunks which are left empty
+// after erase are released except one spare chunk
 class BasePool
 {
 public:
-	BasePool(size_t elementSize, size_t chunkSize = 8192);
+	static const uint32_t INVALID_INDEX = ~0U;
+
+	BasePool(size_t elementSize, size_t chunkSize = 8192, 
+		ChunkAllocatorFunctions allocator = ChunkAllocatorFunctions::of<AlignedChunkAllocator<>>());
 	virtual ~BasePool();
 
-	void expand(size_t n);
+	// Returns uninitialized memory for element of specified entity
+	// If entity already has element, it is destroyed and its memory is reused
+	// Element is marked as added and changed with specified version
+	void* insert(uint32_t entityIndex, uint32_t version = 0);
+
+	// Adds uninitialized elements for entities which have no elements yet
+	// Returns dense position of the first of them, the rest follow it
+	size_t append(const uint32_t* entityIndices, size_t count, uint32_t version = 0);
+
+	// Destroys element of specified entity and moves last element in its place
+	void erase(uint32_t entityIndex);
+
+	// Destroys all elements and releases all chunks
+	void clear();
+
 	void reserve(size_t n);
-	virtual void destroy(size_t n) = 0;
 
-	void* get(size_t n);
-	const void* get(size_t n) const;
+	// Releases chunks which have no elements
+	void shrinkToFit();
+
+	// Exchanges elements at specified dense positions with their entities
+	void swap(size_t first, size_t second);
+
+	// Moves elements so they are ordered by entity index
+	// Pools with the same entities are then visited in the same order
+	void sortByEntityIndex();
+
+	// Returns true if elements are ordered by entity index
+	bool isSorted() const;
+
+	bool contains(uint32_t entityIndex) const;
+
+	// Returns dense position of element of specified entity or INVALID_INDEX
+	uint32_t find(uint32_t entityIndex) const;
+
+	// Returns element of specified entity or nullptr
+	void* get(uint32_t entityIndex);
+	const void* get(uint32_t entityIndex) const;
+
+	// Returns element at specified dense position
+	// Pools which split elements into fields return only the start of slot
+	void* at(size_t n);
+	const void* at(size_t n) const;
+
+	// Returns entity index of element at specified dense position
+	uint32_t getEntityIndex(size_t n) const;
+	const std::vector<uint32_t>& getEntityIndices() const;
+
+	// Can be called concurrently for different elements
+	void markChanged(size_t n, uint32_t version)
+	{
+		m_changeVersions[n] = version;
+
+		std::atomic<uint32_t>& chunkVersion = m_chunkVersions[n / m_chunkSize].changed;
+		if (chunkVersion.load(std::memory_order_relaxed) < version) {
+			chunkVersion.store(version, std::memory_order_relaxed);
+		}
+	}
+
+	uint32_t getChangeVersion(size_t n) const { return m_changeVersions[n]; }
+	uint32_t getAddVersion(size_t n) const { return m_addVersions[n]; }
+
+	uint32_t getChunkChangeVersion(size_t chunk) const { return m_chunkVersions[chunk].changed.load(std::memory_order_relaxed); }
+	uint32_t getChunkAddVersion(size_t chunk) const { return m_chunkVersions[chunk].added.load(std::memory_order_relaxed); }
 
 	size_t getSize() const;
 	size_t getCapacity() const;
+	size_t getElementSize() const;
+	size_t getChunkSize() const;
 	size_t getChunkCount() const;
-	
+
+	// Returns raw memory of chunk
+	const char* getChunk(size_t n) const;
+
+	// Replaces elements with copies of raw chunks laid out as in this pool
+	// Elements must be trivially copyable, entity indices may be unaligned
+	void assignChunks(const void* entityIndices, size_t count, const char* chunks, uint32_t version);
+
+	// Returns size of allocated chunks in bytes
+	size_t getCommittedBytes() const;
+	// Returns size of elements in bytes
+	size_t getUsedBytes() const;
+
 protected:
+	struct ChunkVersions
+	{
+		ChunkVersions() : changed(0), added(0) {}
+		ChunkVersions(const ChunkVersions& other) :
+			changed(other.changed.load()), added(other.added.load())
+		{}
+
+		std::atomic<uint32_t> changed;
+		std::atomic<uint32_t> added;
+	};
+
+	// Element operations by dense position, so elements don't have to be
+	// stored as whole objects
+	virtual void destroyElement(size_t n) = 0;
+
+	// Constructs target from source and destroys source
+	virtual void moveElement(size_t target, size_t source) = 0;
+
+	virtual void swapElements(size_t first, size_t second) = 0;
+
+	void setVersions(size_t n, uint32_t changeVersion, uint32_t addVersion);
+
+	// Releases empty chunks at the end except specified number of them
+	void releaseChunks(size_t spareCount);
+
 	std::vector<char*> m_chunks;
+	std::vector<uint32_t> m_sparse;
+	std::vector<uint32_t> m_dense;
+	std::vector<uint32_t> m_changeVersions;
+	std::vector<uint32_t> m_addVersions;
+	std::vector<ChunkVersions> m_chunkVersions;
 	size_t m_elementSize;
 	size_t m_chunkSize;
-	size_t m_size;
 	size_t m_capacity;
+	bool m_isSorted;
+
+	ChunkAllocatorFunctions m_allocator;
 };
 
 
-template<typename T, size_t ChunkSize = 8192>
+template<typename T, size_t ChunkSize = 8192, typename Allocator = typename ChunkAllocatorTraits<T>::Allocator>
 class Pool : public BasePool
 {
 public:
 	Pool() :
-		BasePool(sizeof(T), ChunkSize)
+		BasePool(sizeof(T), ChunkSize, ChunkAllocatorFunctions::of<Allocator>())
 	{}
 
-	virtual ~Pool() {}
+	virtual ~Pool()
+	{
+		clear();
+	}
 
-	virtual void destroy(size_t n) override
+	T* get(uint32_t entityIndex)
 	{
-		if (n < m_size) {
-			T* ptr = reinterpret_cast<T*>(get(n));
-			ptr->~T();
-		}
+		return reinterpret_cast<T*>(BasePool::get(entityIndex));
+	}
+
+	const T* get(uint32_t entityIndex) const
+	{
+		return reinterpret_cast<const T*>(BasePool::get(entityIndex));
+	}
+
+	T* at(size_t n)
+	{
+		return reinterpret_cast<T*>(m_chunks[n / ChunkSize] + (n % ChunkSize) * sizeof(T));
+	}
+
+	const T* at(size_t n) const
+	{
+		return reinterpret_cast<const T*>(m_chunks[n / ChunkSize] + (n % ChunkSize) * sizeof(T));
+	}
+
+	// Constructs element of specified entity
+	template<typename... Args>
+	T* emplace(uint32_t entityIndex, uint32_t version, Args&&... args)
+	{
+		return new(insert(entityIndex, version)) T(std::forward<Args>(args)...);
+	}
+
+	T load(size_t n) const
+	{
+		return *at(n);
+	}
+
+	void store(size_t n, const T& value)
+	{
+		*at(n) = value;
+	}
+
+protected:
+	void destroyElement(size_t n) override
+	{
+		at(n)->~T();
+	}
+
+	void moveElement(size_t target, size_t source) override
+	{
+		T* sourceElement = at(source);
+		new(at(target)) T(std::move(*sourceElement));
+		sourceElement->~T();
+	}
+
+	void swapElements(size_t first, size_t second) override
+	{
+		T* firstElement = at(first);
+		T* secondElement = at(second);
+
+		T temp(std::move(*firstElement));
+		firstElement->~T();
+		new(firstElement) T(std::move(*secondElement));
+		secondElement->~T();
+		new(secondElement) T(std::move(temp));
 	}
 };
\ No newline at end of file
@@ -0,0 +1,100 @@
+#include "Prefab.h"
+
+#include "GameObject.h"
+
+Prefab::Prefab(const GameObject & root) :
+	m_manager(root.m_manager)
+{
+	// breadth first order keeps parents before children and children
+	// in their original order
+	std::vector<const GameObject*> objects;
+	std::vector<uint32_t> parents;
+	objects.push_back(&root);
+	parents.push_back(BasePool::INVALID_INDEX);
+
+	for (size_t i = 0; i < objects.size(); ++i) {
+		const GameObject* object = objects[i];
+
+		Node node;
+		node.name = object->m_name;
+		node.tag = object->m_tag;
+		node.isActive = object->m_isActive;
+		node.position = object->m_position;
+		node.rotation = object->m_rotation;
+		node.scale = object->m_scale;
+		node.parent = parents[i];
+		m_nodes.push_back(node);
+
+		EntityManager::forEachComponent(m_manager->m_entityComponentMasks[object->m_id.getIndex()], [&](size_t family) {
+			if (m_components.size() <= family) {
+				m_components.resize(family + 1);
+			}
+
+			auto& list = m_components[family];
+			if (list == nullptr) {
+				list = m_manager->m_componentHelpers[family]->createList();
+			}
+			list->push(m_manager, object->m_id, static_cast<uint32_t>(i));
+		});
+
+		for (const GameObject* child = object->getFirstChild(); child != nullptr; child = child->getNextSibling()) {
+			objects.push_back(child);
+			parents.push_back(static_cast<uint32_t>(i));
+		}
+	}
+}
+
+std::shared_ptr<GameObject> Prefab::instantiate() const
+{
+	return instantiate(1).front();
+}
+
+std::vector<std::shared_ptr<GameObject>> Prefab::instantiate(size_t count) const
+{
+	std::vector<std::shared_ptr<GameObject>> roots;
+	if (count == 0) {
+		return roots;
+	}
+
+	const size_t nodeCount = m_nodes.size();
+	std::vector<EntityId> entities = m_manager->allocateEntities(nodeCount * count);
+
+	roots.reserve(count);
+	for (size_t i = 0; i < entities.size(); ++i) {
+		const Node& node = m_nodes[i % nodeCount];
+		GameObject* object = m_manager->m_gameObjects.get(entities[i].getIndex());
+
+		object->setActive(node.isActive);
+		m_manager->m_gameObjects.setName(entities[i].getIndex(), node.name);
+		object->m_tag = node.tag;
+		object->setPosition(node.position);
+		object->setRotation(node.rotation);
+		object->setScale(node.scale);
+
+		// only roots are shared, so nodes don't get control blocks
+		if (node.parent == BasePool::INVALID_INDEX) {
+			roots.push_back(m_manager->m_gameObjects.share(entities[i].getIndex()));
+		}
+		else {
+			const size_t parent = i - i % nodeCount + node.parent;
+			object->setParent(m_manager->m_gameObjects.get(entities[parent].getIndex()));
+		}
+	}
+
+	for (const auto& list : m_components) {
+		if (list != nullptr) {
+			list->assignTo(m_manager, entities, nodeCount);
+		}
+	}
+
+	if (m_manager->hasSubscribers<Events::OnEntitiesCreated>()) {
+		m_manager->emit<Events::OnEntitiesCreated>({ entities });
+	}
+
+	return roots;
+}
+
+size_t Prefab::getNodeCount() const
+{
+	return m_nodes.size();
+}
\ No newline at end of file
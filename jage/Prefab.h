@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "EntityManager.h"
+#include "Math.h"
+
+class GameObject;
+
+// Copy of GameObject with its children and their components
+// Components are grouped by type, so each instantiation assigns every
+// type to all new entities at once instead of copying object by object
+class Prefab
+{
+public:
+	// Captures current state of object and its subtree
+	Prefab(const GameObject& root);
+
+	// Creates copy of captured tree and returns its root
+	std::shared_ptr<GameObject> instantiate() const;
+
+	// Creates count copies of captured tree and returns their roots
+	// Emits single OnEntitiesCreated event for all created entities
+	std::vector<std::shared_ptr<GameObject>> instantiate(size_t count) const;
+
+	size_t getNodeCount() const;
+
+private:
+	struct Node
+	{
+		StringId name;
+		StringId tag;
+		bool isActive;
+
+		vec3 position;
+		quat rotation;
+		vec3 scale;
+
+		// index of parent node, parents are stored before their children
+		uint32_t parent;
+	};
+
+	EntityManager* m_manager;
+
+	std::vector<Node> m_nodes;
+	std::vector<std::unique_ptr<detail::BaseComponentList>> m_components;
+};
\ No newline at end of file
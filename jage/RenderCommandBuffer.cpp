@@ -10,7 +10,7 @@ RenderCommandBuffer::~RenderCommandBuffer()
 	clear();
 }
 
-void RenderCommandBuffer::push(Mesh * mesh, const mat4 & transform, Material * material, FrameBuffer * target)
+void RenderCommandBuffer::push(Mesh * mesh, const mat4 & transform, const Material * material, FrameBuffer * target)
 {
 	if (mesh == nullptr || material == nullptr) return;
 
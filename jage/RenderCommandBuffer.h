@@ -15,13 +15,13 @@ struct RenderCommand
 		mesh(nullptr), transform(1.0f), material(nullptr)
 	{}
 
-	RenderCommand(Mesh* mesh, const mat4& transform, Material* material) :
+	RenderCommand(Mesh* mesh, const mat4& transform, const Material* material) :
 		mesh(mesh), transform(transform), material(material)
 	{}
 
 	Mesh* mesh;
 	mat4 transform;
-	Material* material;
+	const Material* material;
 };
 
 struct PostProcessCommand
@@ -51,7 +51,7 @@ public:
 	RenderCommandBuffer(RenderingSystem* renderingSystem);
 	~RenderCommandBuffer();
 
-	void push(Mesh* mesh, const mat4& transform, Material* material, FrameBuffer* target = nullptr);
+	void push(Mesh* mesh, const mat4& transform, const Material* material, FrameBuffer* target = nullptr);
 	void clear();
 
 	void sort();
@@ -8,6 +8,10 @@
 
 void RenderingSystem::init()
 {
+	reads<MeshComponent, Shared<MeshComponent>>();
+	writes<CameraComponent, LightComponent>();
+	setMainThreadOnly(true);
+
 	m_manager->subscribe<Events::OnWindowResized>(this);
 
 	m_quad = std::make_shared<Mesh>();
@@ -50,19 +54,21 @@ void RenderingSystem::update(const float dt)
 	}
 
 	m_manager->each<CameraComponent>([this](EntityId id, CameraComponent& component) {
-		std::shared_ptr<GameObject> object = m_manager->get(id);
+		component.updateView(getWorldTransformation(id));
+		component.updateProjection();
+	});
 
-		if (object != nullptr) {
-			component.updateView(object->getGlobalTransformation());
-			component.updateProjection();
-		}
+	m_manager->each<const MeshComponent>([this](EntityId id, const MeshComponent& component) {
+		m_commandBuffer->push(component.getMesh(), getWorldTransformation(id), component.getMaterial());
 	});
 
-	m_manager->each<MeshComponent>([this](EntityId id, MeshComponent& component) {
-		std::shared_ptr<GameObject> object = m_manager->get(id);
+	// entities with the same mesh and material are pushed together
+	m_manager->eachShared<MeshComponent>([this](const MeshComponent& component, const std::vector<uint32_t>& entities) {
+		Mesh* mesh = component.getMesh();
+		const Material* material = component.getMaterial();
 
-		if (object != nullptr) {
-			m_commandBuffer->push(component.getMesh(), object->getGlobalTransformation(), component.getMaterial());
+		for (auto index : entities) {
+			m_commandBuffer->push(mesh, getWorldTransformation(m_manager->createId(index)), material);
 		}
 	});
 
@@ -109,10 +115,10 @@ void RenderingSystem::update(const float dt)
 	RenderStateManager::setFaceCullingSide(GL_FRONT);
 	std::vector<RenderCommand> shadowRenderCommands = m_commandBuffer->getShadowCastRenderCommands();
 	m_manager->each<LightComponent>([this, &shadowRenderCommands](EntityId id, LightComponent& component) {
-		std::shared_ptr<GameObject> object = m_manager->get(id);
+		GameObject* object = m_manager->getObject(id);
 
 		if (object != nullptr && component.isShadowCastingEnabled()) {
-			component.updateView(object->getGlobalTransformation());
+			component.updateView(getWorldTransformation(id));
 			component.updateProjection();
 
 			component.getShadowBuffer()->bind();
@@ -146,7 +152,7 @@ void RenderingSystem::update(const float dt)
 	mat4 inversedViewProjection = glm::inverse(m_mainCameraData->getViewProjectionMatrix());
 
 	m_manager->each<LightComponent>([this, &inversedViewProjection](EntityId id, LightComponent& component) {
-		std::shared_ptr<GameObject> object = m_manager->get(id);
+		GameObject* object = m_manager->getObject(id);
 
 		LightMaterial* lightMaterial = component.getMaterial();
 
@@ -227,14 +233,22 @@ void RenderingSystem::update(const float dt)
 	m_commandBuffer->clear();
 }
 
-void RenderingSystem::setMainCamera(std::shared_ptr<GameObject> camera)
+void RenderingSystem::setMainCamera(GameObject* camera)
 {
 	if (camera != nullptr) {
-		m_mainCamera = camera;
+		m_mainCamera = camera->getId();
 		m_mainCameraData = camera->getComponent<CameraComponent>();
 	}
 }
 
+void RenderingSystem::setTransformSystem(std::shared_ptr<TransformSystem> transformSystem)
+{
+	m_transformSystem = transformSystem;
+	if (transformSystem != nullptr) {
+		dependsOn(transformSystem.get());
+	}
+}
+
 void RenderingSystem::onReceive(EntityManager * manager, const Events::OnWindowResized & event)
 {
 	m_renderSize = event.windowSize;
@@ -254,10 +268,20 @@ void RenderingSystem::addPostProcess(size_t order, Material * material)
 	m_postProcessCommands.emplace(order, material);
 }
 
+mat4 RenderingSystem::getWorldTransformation(EntityId id) const
+{
+	if (m_transformSystem != nullptr) {
+		return m_transformSystem->getWorldTransformation(id);
+	}
+
+	GameObject* object = m_manager->getObject(id);
+	return object != nullptr ? object->getGlobalTransformation() : mat4(1.0f);
+}
+
 void RenderingSystem::renderCustomCommand(const RenderCommand * command, bool affectRenderState)
 {
 	const Mesh* mesh;
-	Material* material;
+	const Material* material;
 	Shader* shader;
 
 	if ((mesh = command->mesh) == nullptr ||
@@ -283,7 +307,7 @@ void RenderingSystem::renderCustomCommand(const RenderCommand * command, bool af
 	shader->setUniform("u_transformation", command->transform);
 	shader->setUniform("u_cameraProjection", m_mainCameraData->getProjectionMatrix());
 	shader->setUniform("u_cameraViewProjection", m_mainCameraData->getViewProjectionMatrix());
-	shader->setUniform("u_cameraViewRotation", m_mainCamera->getRotationMatrixInversed());
+	shader->setUniform("u_cameraViewRotation", m_manager->getObject(m_mainCamera)->getRotationMatrixInversed());
 
 	const auto& textures = material->getTextures();
 	for (size_t i = 0; i < textures.size(); ++i) {
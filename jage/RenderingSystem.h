@@ -4,6 +4,7 @@
 
 #include "RenderCommandBuffer.h"
 #include "EntityManager.h"
+#include "TransformSystem.h"
 #include "FrameBuffer.h"
 #include "GameObject.h"
 
@@ -37,13 +38,18 @@ public:
 
 	void update(const float dt) override;
 
-	void setMainCamera(std::shared_ptr<GameObject> camera);
+	void setMainCamera(GameObject* camera);
+
+	// World transformations are taken from transform system when it is set
+	void setTransformSystem(std::shared_ptr<TransformSystem> transformSystem);
 
 	void onReceive(EntityManager* manager, const Events::OnWindowResized& event) override;
 
 	void addPostProcess(size_t order, Material* material);
 
 private:
+	mat4 getWorldTransformation(EntityId id) const;
+
 	void renderCustomCommand(const RenderCommand* command, bool affectRenderState = true);
 	void renderShadowCastCommand(const RenderCommand* command, LightComponent* lightData);
 	void renderPostProcessingCommand(const PostProcessCommand* command);
@@ -51,7 +57,9 @@ private:
 	ivec2 m_renderSize;
 
 	ComponentHandle<CameraComponent> m_mainCameraData;
-	std::shared_ptr<GameObject> m_mainCamera;
+	EntityId m_mainCamera;
+
+	std::shared_ptr<TransformSystem> m_transformSystem;
 
 	std::shared_ptr<Mesh> m_quad;
 	std::unique_ptr<FrameBuffer> m_geometryBuffer;
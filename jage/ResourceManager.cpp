@@ -1,6 +1,6 @@
 #include "ResourceManager.h"
 
-std::map<std::pair<std::string, std::type_index>, std::unique_ptr<AbstractFactory>> ResourceManager::m_factories;
+std::unordered_map<ResourceManager::Key, std::unique_ptr<AbstractFactory>, ResourceManager::KeyHash> ResourceManager::m_factories;
 
 void ResourceManager::init(const std::string & path)
 {
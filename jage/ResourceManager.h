@@ -1,10 +1,11 @@
 #pragma once
 
+#include <unordered_map>
 #include <memory>
 #include <string>
-#include <map>
 
 #include "AbstractFactory.h"
+#include "StringId.h"
 #include "Log.h"
 
 // Allows deffered creating of resources
@@ -21,7 +22,7 @@ public:
 	// Clears up all resources
 	static void close();
 
-	// Attaches resource factory to specified name
+	// Attaches resource factory to specified name, name is interned
 	// T - AbstractFactory child class type
 	// Args - AbstractFactory child class constructor arguments
 	template <class T, class... Args>
@@ -32,7 +33,7 @@ public:
 
 		std::unique_ptr<AbstractFactory> factory = std::make_unique<T>(std::forward<Args>(args)...);
 
-		auto key = std::make_pair(name, factory->getStoredTypeIndex());
+		Key key(StringId::intern(name), factory->getStoredTypeIndex());
 
 		auto it = m_factories.find(key);
 		if (it == m_factories.end()) {
@@ -44,9 +45,9 @@ public:
 	// Detaches resource factory from specified name
 	// T - Stored type
 	template <class T>
-	static void unbind(const std::string& name)
+	static void unbind(StringId name)
 	{
-		auto key = std::make_pair(name, std::type_index(typeid(T)));
+		Key key(name, std::type_index(typeid(T)));
 
 		auto it = m_factories.find(key);
 		if (it != m_factories.end()) {
@@ -58,13 +59,13 @@ public:
 	// If there is no such resource nullptr will be returned
 	// T - Stored type
 	template <class T>
-	static T* get(const std::string& name)
+	static T* get(StringId name)
 	{
-		auto key = std::make_pair(name, std::type_index(typeid(T)));
+		Key key(name, std::type_index(typeid(T)));
 		
 		auto it = m_factories.find(key);
 		if (it == m_factories.end()) {
-			throw std::runtime_error("Unable to get resource: \"" + name + "\", \"" + key.second.name() + "\"");
+			throw std::runtime_error("Unable to get resource: \"" + name.getString() + "\", \"" + key.second.name() + "\"");
 		}
 		else {
 			return reinterpret_cast<T*>(it->second->load());
@@ -73,9 +74,9 @@ public:
 
 	// Clear specified resource, but don't delete it from map
 	template <class T>
-	static void clear(const std::string& name)
+	static void clear(StringId name)
 	{
-		auto key = std::make_pair(name, std::type_index(typeid(T)));
+		Key key(name, std::type_index(typeid(T)));
 
 		auto it = m_factories.find(key);
 		if (it != m_factories.end()) {
@@ -84,5 +85,15 @@ public:
 	}
 
 private:
-	static std::map<std::pair<std::string, std::type_index>, std::unique_ptr<AbstractFactory>> m_factories;
+	typedef std::pair<StringId, std::type_index> Key;
+
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const
+		{
+			return std::hash<StringId>()(key.first) ^ (key.second.hash_code() * 31);
+		}
+	};
+
+	static std::unordered_map<Key, std::unique_ptr<AbstractFactory>, KeyHash> m_factories;
 };
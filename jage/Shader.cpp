@@ -1,5 +1,7 @@
 #include "Shader.h"
 
+#include <algorithm>
+
 #include "RenderStateManager.h"
 
 Shader::Shader()
@@ -69,6 +71,8 @@ bool Shader::link(std::string& infoLog)
 		return false;
 	}
 
+	cacheUniformLocations();
+
 	return true;
 }
 
@@ -77,110 +81,141 @@ void Shader::setAttribute(unsigned int index, const std::string & name)
 	glBindAttribLocation(m_program, index, name.c_str());
 }
 
-void Shader::setUniform(const std::string & name, int data)
+void Shader::setUniform(StringId name, int data)
 {
 	glUniform1i(getUniformLocation(name), data);
 }
 
-void Shader::setUniform(const std::string & name, float data)
+void Shader::setUniform(StringId name, float data)
 {
 	glUniform1f(getUniformLocation(name), data);
 }
 
-void Shader::setUniform(const std::string & name, const vec2 & data)
+void Shader::setUniform(StringId name, const vec2 & data)
 {
 	glUniform2f(getUniformLocation(name), data.x, data.y);
 }
 
-void Shader::setUniform(const std::string & name, const ivec2 & data)
+void Shader::setUniform(StringId name, const ivec2 & data)
 {
 	glUniform2i(getUniformLocation(name), data.x, data.y);
 }
 
-void Shader::setUniform(const std::string & name, const vec3 & data)
+void Shader::setUniform(StringId name, const vec3 & data)
 {
 	glUniform3f(getUniformLocation(name), data.x, data.y, data.z);
 }
 
-void Shader::setUniform(const std::string & name, const ivec3 & data)
+void Shader::setUniform(StringId name, const ivec3 & data)
 {
 	glUniform3i(getUniformLocation(name), data.x, data.y, data.z);
 }
 
-void Shader::setUniform(const std::string & name, const vec4 & data)
+void Shader::setUniform(StringId name, const vec4 & data)
 {
 	glUniform4f(getUniformLocation(name), data.x, data.y, data.z, data.w);
 }
 
-void Shader::setUniform(const std::string & name, const ivec4 & data)
+void Shader::setUniform(StringId name, const ivec4 & data)
 {
 	glUniform4i(getUniformLocation(name), data.x, data.y, data.z, data.w);
 }
 
-void Shader::setUniform(const std::string & name, const mat4 & data)
+void Shader::setUniform(StringId name, const mat4 & data)
 {
 	glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, int * data, int size)
+void Shader::setUniformArray(StringId name, int * data, int size)
 {
 	glUniform1iv(getUniformLocation(name), size, data);
 }
 
-void Shader::setUniformArray(const std::string & name, float * data, int size)
+void Shader::setUniformArray(StringId name, float * data, int size)
 {
 	glUniform1fv(getUniformLocation(name), size, data);
 }
 
-void Shader::setUniformArray(const std::string & name, vec2 * data, int size)
+void Shader::setUniformArray(StringId name, vec2 * data, int size)
 {
 	glUniform2fv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, ivec2 * data, int size)
+void Shader::setUniformArray(StringId name, ivec2 * data, int size)
 {
 	glUniform2iv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, vec3 * data, int size)
+void Shader::setUniformArray(StringId name, vec3 * data, int size)
 {
 	glUniform3fv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, ivec3 * data, int size)
+void Shader::setUniformArray(StringId name, ivec3 * data, int size)
 {
 	glUniform3iv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, vec4 * data, int size)
+void Shader::setUniformArray(StringId name, vec4 * data, int size)
 {
 	glUniform4fv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, ivec4 * data, int size)
+void Shader::setUniformArray(StringId name, ivec4 * data, int size)
 {
 	glUniform4iv(getUniformLocation(name), size, &data[0][0]);
 }
 
-void Shader::setUniformArray(const std::string & name, mat4 * data, int size)
+void Shader::setUniformArray(StringId name, mat4 * data, int size)
 {
 	glUniformMatrix4fv(getUniformLocation(name), size, GL_FALSE, &data[0][0][0]);
 }
 
-unsigned int Shader::getUniformLocation(const std::string & name)
+unsigned int Shader::getUniformLocation(StringId name)
 {
 	auto it = m_uniformLocations.find(name);
-	if (it == m_uniformLocations.end()) {
-		GLuint location = glGetUniformLocation(m_program, name.c_str());
-		m_uniformLocations[name] = location;
-		return location;
-	}
-	else {
-		return it->second;
-	}
+	return it != m_uniformLocations.end() ? it->second : -1;
 }
 
 GLuint Shader::getHandle() const
 {
 	return m_program;
 }
+
+void Shader::cacheUniformLocations()
+{
+	m_uniformLocations.clear();
+
+	GLint uniformCount = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORMS, &uniformCount);
+
+	GLint maxNameLength = 0;
+	glGetProgramiv(m_program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<GLchar> nameBuffer(std::max(maxNameLength, 1));
+
+	for (GLint i = 0; i < uniformCount; ++i) {
+		GLsizei nameLength = 0;
+		GLint size = 0;
+		GLenum type;
+		glGetActiveUniform(m_program, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()), 
+			&nameLength, &size, &type, nameBuffer.data());
+
+		std::string name(nameBuffer.data(), nameLength);
+		const GLint location = glGetUniformLocation(m_program, name.c_str());
+		m_uniformLocations[StringId(name)] = location;
+
+		// arrays are usually reported as "name[0]", array can be set by its
+		// name and each element by name with index
+		const bool hasIndex = name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0;
+		if (hasIndex || size > 1) {
+			const std::string arrayName = hasIndex ? name.substr(0, name.size() - 3) : name;
+			m_uniformLocations[StringId(arrayName)] = location;
+			m_uniformLocations[StringId(arrayName + "[0]")] = location;
+
+			for (GLint element = 1; element < size; ++element) {
+				const std::string elementName = arrayName + "[" + std::to_string(element) + "]";
+				m_uniformLocations[StringId(elementName)] = glGetUniformLocation(m_program, elementName.c_str());
+			}
+		}
+	}
+}
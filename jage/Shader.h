@@ -1,11 +1,12 @@
 #pragma once
 
+#include <unordered_map>
 #include <string>
 #include <vector>
-#include <map>
 
 #include <GL/glew.h>
 
+#include "StringId.h"
 #include "Math.h"
 
 class Shader
@@ -21,33 +22,36 @@ public:
 
 	void setAttribute(unsigned int index, const std::string& name);
 
-	void setUniform(const std::string& name, int data);
-	void setUniform(const std::string& name, float data);
-	void setUniform(const std::string& name, const vec2& data);
-	void setUniform(const std::string& name, const ivec2& data);
-	void setUniform(const std::string& name, const vec3& data);
-	void setUniform(const std::string& name, const ivec3& data);
-	void setUniform(const std::string& name, const vec4& data);
-	void setUniform(const std::string& name, const ivec4& data);
-	void setUniform(const std::string& name, const mat4& data);
-
-	void setUniformArray(const std::string& name, int* data, int size);
-	void setUniformArray(const std::string& name, float* data, int size);
-	void setUniformArray(const std::string& name, vec2* data, int size);
-	void setUniformArray(const std::string& name, ivec2* data, int size);
-	void setUniformArray(const std::string& name, vec3* data, int size);
-	void setUniformArray(const std::string& name, ivec3* data, int size);
-	void setUniformArray(const std::string& name, vec4* data, int size);
-	void setUniformArray(const std::string& name, ivec4* data, int size);
-	void setUniformArray(const std::string& name, mat4* data, int size);
-
-	unsigned int getUniformLocation(const std::string& name);
+	void setUniform(StringId name, int data);
+	void setUniform(StringId name, float data);
+	void setUniform(StringId name, const vec2& data);
+	void setUniform(StringId name, const ivec2& data);
+	void setUniform(StringId name, const vec3& data);
+	void setUniform(StringId name, const ivec3& data);
+	void setUniform(StringId name, const vec4& data);
+	void setUniform(StringId name, const ivec4& data);
+	void setUniform(StringId name, const mat4& data);
+
+	void setUniformArray(StringId name, int* data, int size);
+	void setUniformArray(StringId name, float* data, int size);
+	void setUniformArray(StringId name, vec2* data, int size);
+	void setUniformArray(StringId name, ivec2* data, int size);
+	void setUniformArray(StringId name, vec3* data, int size);
+	void setUniformArray(StringId name, ivec3* data, int size);
+	void setUniformArray(StringId name, vec4* data, int size);
+	void setUniformArray(StringId name, ivec4* data, int size);
+	void setUniformArray(StringId name, mat4* data, int size);
+
+	// Returns location of active uniform or -1, locations are cached on link
+	unsigned int getUniformLocation(StringId name);
 
 	GLuint getHandle() const;
 
 private:
+	void cacheUniformLocations();
+
 	GLuint m_program;
 
 	std::vector<GLint> m_shaders;
-	std::map<std::string, GLint> m_uniformLocations;
+	std::unordered_map<StringId, GLint> m_uniformLocations;
 };
\ No newline at end of file
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <unordered_map>
+#include <functional>
+#include <memory>
+
+#include "SoAPool.h"
+
+template<typename T>
+class SharedPool;
+
+// Component which refers to deduplicated value
+// Entities which are assigned equal values refer to the same one, value
+// can be replaced only by assigning component again
+// T must be comparable and have std::hash specialization
+template<typename T>
+class Shared
+{
+public:
+	typedef T ValueType;
+
+	const T& operator*() const { return *m_value; }
+	const T* operator->() const { return m_value; }
+	const T* get() const { return m_value; }
+
+	// Returns index of value, entities with the same value have the same index
+	uint32_t getValueIndex() const { return m_valueIndex; }
+
+private:
+	friend class SharedPool<T>;
+
+	Shared(const T* value, uint32_t valueIndex, uint32_t position) :
+		m_value(value), m_valueIndex(valueIndex), m_position(position)
+	{}
+
+	const T* m_value;
+	uint32_t m_valueIndex;
+	uint32_t m_position;
+};
+
+
+// Pool of shared components
+// Each distinct value is stored once with the list of entities which refer
+// to it, so entities can be visited grouped by value. Value is released
+// when the last entity which refers to it is removed
+template<typename T>
+class SharedPool : public Pool<Shared<T>>
+{
+public:
+	virtual ~SharedPool()
+	{
+		// elements release values, so they must be destroyed first
+		Pool<Shared<T>>::clear();
+	}
+
+	// Constructs value or finds equal one and refers entity to it
+	template<typename... Args>
+	Shared<T>* emplace(uint32_t entityIndex, uint32_t version, Args&&... args)
+	{
+		// value is built before previous one of entity can be released
+		T newValue = makeValue(std::forward<Args>(args)...);
+
+		void* memory = Pool<Shared<T>>::insert(entityIndex, version);
+		const uint32_t valueIndex = acquire(std::move(newValue));
+
+		Value& value = *m_values[valueIndex];
+		value.entities.push_back(entityIndex);
+
+		return new(memory) Shared<T>(&value.value, valueIndex,
+			static_cast<uint32_t>(value.entities.size() - 1));
+	}
+
+	// Calls func(const T& value, const std::vector<uint32_t>& entityIndices)
+	// for each distinct value
+	template<typename Func>
+	void eachValue(Func&& func) const
+	{
+		for (const auto& value : m_values) {
+			if (value != nullptr) {
+				func(value->value, value->entities);
+			}
+		}
+	}
+
+	// Returns number of distinct values
+	size_t getValueCount() const
+	{
+		return m_values.size() - m_freeValues.size();
+	}
+
+protected:
+	void destroyElement(size_t n) override
+	{
+		const Shared<T>* element = Pool<Shared<T>>::at(n);
+		Value& value = *m_values[element->m_valueIndex];
+
+		// entity which was last in the list takes place of removed one
+		const uint32_t lastEntityIndex = value.entities.back();
+		if (lastEntityIndex != BasePool::getEntityIndex(n)) {
+			value.entities[element->m_position] = lastEntityIndex;
+			Pool<Shared<T>>::get(lastEntityIndex)->m_position = element->m_position;
+		}
+		value.entities.pop_back();
+
+		if (value.entities.empty()) {
+			release(element->m_valueIndex);
+		}
+
+		Pool<Shared<T>>::destroyElement(n);
+	}
+
+private:
+	struct Value
+	{
+		Value(T&& value) :
+			value(std::move(value))
+		{}
+
+		T value;
+		std::vector<uint32_t> entities;
+	};
+
+	// Shared component is copied by its value
+	template<typename... Args>
+	static T makeValue(Args&&... args)
+	{
+		if constexpr (sizeof...(Args) == 1 &&
+			std::conjunction<std::is_same<typename std::decay<Args>::type, Shared<T>>...>::value)
+		{
+			return T(*args...);
+		}
+		else {
+			return T(std::forward<Args>(args)...);
+		}
+	}
+
+	uint32_t acquire(T&& value)
+	{
+		const size_t hash = std::hash<T>()(value);
+
+		auto range = m_lookup.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (m_values[it->second]->value == value) {
+				return it->second;
+			}
+		}
+
+		uint32_t valueIndex;
+		if (m_freeValues.empty()) {
+			valueIndex = static_cast<uint32_t>(m_values.size());
+			m_values.emplace_back(nullptr);
+		}
+		else {
+			valueIndex = m_freeValues.back();
+			m_freeValues.pop_back();
+		}
+
+		m_values[valueIndex] = std::make_unique<Value>(std::move(value));
+		m_lookup.emplace(hash, valueIndex);
+
+		return valueIndex;
+	}
+
+	void release(uint32_t valueIndex)
+	{
+		auto range = m_lookup.equal_range(std::hash<T>()(m_values[valueIndex]->value));
+		for (auto it = range.first; it != range.second; ++it) {
+			if (it->second == valueIndex) {
+				m_lookup.erase(it);
+				break;
+			}
+		}
+
+		m_values[valueIndex].reset();
+		m_freeValues.push_back(valueIndex);
+	}
+
+	std::vector<std::unique_ptr<Value>> m_values;
+	std::vector<uint32_t> m_freeValues;
+	std::unordered_multimap<size_t, uint32_t> m_lookup;
+};
+
+
+template<typename T>
+struct ComponentPoolTraits<Shared<T>>
+{
+	typedef SharedPool<T> Type;
+};
\ No newline at end of file
@@ -31,7 +31,7 @@ SkyMaterial::~SkyMaterial()
 {
 }
 
-void SkyMaterial::bind()
+void SkyMaterial::bind() const
 {
 	m_shader->bind();
 
@@ -8,7 +8,7 @@ public:
 	SkyMaterial();
 	~SkyMaterial();
 
-	void bind() override;
+	void bind() const override;
 
 
 	void setRayleigh(float rayleigh);
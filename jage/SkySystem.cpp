@@ -6,8 +6,10 @@
 #include "ResourceManager.h"
 
 SkySystem::SkySystem() :
-	m_sun(nullptr), m_cube(nullptr)
+	m_sun(EntityId::INVALID), m_cube(nullptr)
 {
+	writes<MeshComponent, LightComponent>();
+
 	m_cube = std::make_unique<Mesh>();
 	m_cube->init(MeshGeometry::createCube());
 }
@@ -26,9 +28,9 @@ void SkySystem::update(const float dt)
 	}
 }
 
-void SkySystem::setSun(std::shared_ptr<GameObject> sun)
+void SkySystem::setSun(GameObject* sun)
 {
-	m_sun = sun;
+	m_sun = sun->getId();
 	m_skyRenderingData = sun->getComponent<MeshComponent>();
 	m_sunChanged = true;
 }
@@ -65,13 +67,17 @@ float SkySystem::getAzimuth() const
 
 void SkySystem::updateSun()
 {
-	if (m_sunChanged && m_sun != nullptr && m_skyRenderingData.isValid()) {
-		Log::write(m_currentTime, m_inclination);
-		m_sun->setRotation(m_inclination, 0.0f, 0.0f);
-		//m_sun->rotate(0.0f, m_azimuth, 0.0f);
+	if (!m_sunChanged || !m_manager->isValid(m_sun) || !m_skyRenderingData.isValid()) {
+		return;
+	}
 
-		m_skyRenderingData->getMaterial()->as<SkyMaterial>()->setSunDirection(m_sun->getDirectionFront());
+	GameObject* sun = m_manager->getObject(m_sun);
 
-		m_sunChanged = false;
-	}
+	Log::write(m_currentTime, m_inclination);
+	sun->setRotation(m_inclination, 0.0f, 0.0f);
+	//sun->rotate(0.0f, m_azimuth, 0.0f);
+
+	m_skyRenderingData->getMaterial()->as<SkyMaterial>()->setSunDirection(sun->getDirectionFront());
+
+	m_sunChanged = false;
 }
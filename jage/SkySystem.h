@@ -21,7 +21,7 @@ public:
 
 	void update(const float dt) override;
 
-	void setSun(std::shared_ptr<GameObject> sun);
+	void setSun(GameObject* sun);
 
 	std::shared_ptr<GameObject> createSun();
 
@@ -36,7 +36,7 @@ private:
 	float m_delay;
 	unsigned int m_currentTime;
 
-	std::shared_ptr<GameObject> m_sun;
+	EntityId m_sun;
 	ComponentHandle<MeshComponent> m_skyRenderingData;
 
 	float m_azimuth;
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <type_traits>
+#include <algorithm>
+#include <utility>
+#include <tuple>
+
+#include "Pool.h"
+
+namespace detail
+{
+	template<typename M>
+	struct MemberTraits;
+
+	template<typename C, typename F>
+	struct MemberTraits<F C::*>
+	{
+		typedef C Class;
+		typedef F Field;
+	};
+}
+
+// List of component fields which are stored in separate streams
+template<auto... Members>
+struct SoAFields
+{
+	static const bool isSoA = true;
+	typedef SoAFields Fields;
+};
+
+// Layout of component in pool, components are stored as whole objects
+// by default. Specialize it to store each field in its own stream:
+//
+// template<> struct SoALayout<Body> : SoAFields<&Body::position, &Body::rotation, &Body::scale> {};
+//
+// Only listed fields are stored, they must be trivially copyable
+template<typename T>
+struct SoALayout
+{
+	static const bool isSoA = false;
+	typedef void Fields;
+};
+
+
+template<typename T, size_t ChunkSize = 8192, typename Allocator = AlignedChunkAllocator<>,
+	typename Fields = typename SoALayout<T>::Fields>
+class SoAPool;
+
+// Sparse set of components which are split into field streams
+// Each chunk contains ChunkSize values of the first field, then ChunkSize
+// values of the second one and so on, so every stream of chunk is
+// contiguous and aligned for SIMD loads
+// Components are assembled from streams on load and scattered on store
+template<typename T, size_t ChunkSize, typename Allocator, auto... Members>
+class SoAPool<T, ChunkSize, Allocator, SoAFields<Members...>> : public BasePool
+{
+public:
+	template<size_t I>
+	using Field = typename std::tuple_element<I, std::tuple<typename detail::MemberTraits<decltype(Members)>::Field...>>::type;
+
+	static_assert(ChunkSize % 64 == 0, "Chunk size of SoA pool must be a multiple of 64");
+	static_assert(std::is_default_constructible<T>::value, "SoA component must be default constructible");
+	static_assert(sizeof...(Members) > 0, "SoA component must have at least one field");
+	static_assert(std::conjunction<std::is_trivially_copyable<typename detail::MemberTraits<decltype(Members)>::Field>...>::value,
+		"Fields of SoA component must be trivially copyable");
+
+	SoAPool() :
+		BasePool(getElementSize(), ChunkSize, ChunkAllocatorFunctions::of<Allocator>())
+	{}
+
+	virtual ~SoAPool()
+	{
+		clear();
+	}
+
+	// Returns stream of I-th field in specified chunk
+	template<size_t I>
+	Field<I>* getStream(size_t chunk)
+	{
+		return reinterpret_cast<Field<I>*>(m_chunks[chunk] + getFieldOffset<I>() * ChunkSize);
+	}
+
+	template<size_t I>
+	const Field<I>* getStream(size_t chunk) const
+	{
+		return reinterpret_cast<const Field<I>*>(m_chunks[chunk] + getFieldOffset<I>() * ChunkSize);
+	}
+
+	// Returns I-th field of element at specified dense position
+	template<size_t I>
+	Field<I>* getField(size_t n)
+	{
+		return getStream<I>(n / ChunkSize) + n % ChunkSize;
+	}
+
+	template<size_t I>
+	const Field<I>* getField(size_t n) const
+	{
+		return getStream<I>(n / ChunkSize) + n % ChunkSize;
+	}
+
+	// Constructs component and scatters its fields
+	template<typename... Args>
+	void emplace(uint32_t entityIndex, uint32_t version, Args&&... args)
+	{
+		insert(entityIndex, version);
+		store(find(entityIndex), T(std::forward<Args>(args)...));
+	}
+
+	// Returns component assembled from fields at specified dense position
+	T load(size_t n) const
+	{
+		T value;
+		loadImpl(value, n, std::make_index_sequence<sizeof...(Members)>{});
+		return value;
+	}
+
+	void store(size_t n, const T& value)
+	{
+		storeImpl(value, n, std::make_index_sequence<sizeof...(Members)>{});
+	}
+
+	// Calls func(entityIndices, count, streams...) for parts of chunks
+	// which contain dense positions [begin, end)
+	template<typename Func>
+	void visitStreams(size_t begin, size_t end, Func&& func)
+	{
+		visitImpl(*this, begin, end, func, std::make_index_sequence<sizeof...(Members)>{});
+	}
+
+	template<typename Func>
+	void visitStreams(size_t begin, size_t end, Func&& func) const
+	{
+		visitImpl(*this, begin, end, func, std::make_index_sequence<sizeof...(Members)>{});
+	}
+
+protected:
+	void destroyElement(size_t n) override {}
+
+	void moveElement(size_t target, size_t source) override
+	{
+		moveImpl(target, source, std::make_index_sequence<sizeof...(Members)>{});
+	}
+
+	void swapElements(size_t first, size_t second) override
+	{
+		swapImpl(first, second, std::make_index_sequence<sizeof...(Members)>{});
+	}
+
+private:
+	static constexpr size_t getElementSize()
+	{
+		size_t result = 0;
+		const size_t sizes[] = { sizeof(typename detail::MemberTraits<decltype(Members)>::Field)... };
+		for (size_t size : sizes) {
+			result += size;
+		}
+		return result;
+	}
+
+	template<size_t I>
+	static constexpr size_t getFieldOffset()
+	{
+		size_t result = 0;
+		const size_t sizes[] = { sizeof(typename detail::MemberTraits<decltype(Members)>::Field)... };
+		for (size_t i = 0; i < I; ++i) {
+			result += sizes[i];
+		}
+		return result;
+	}
+
+	template<size_t... Is>
+	void loadImpl(T& value, size_t n, std::index_sequence<Is...>) const
+	{
+		using dummy = int[];
+		(void)dummy {
+			0, (value.*Members = *getField<Is>(n), 0)...
+		};
+	}
+
+	template<size_t... Is>
+	void storeImpl(const T& value, size_t n, std::index_sequence<Is...>)
+	{
+		using dummy = int[];
+		(void)dummy {
+			0, (*getField<Is>(n) = value.*Members, 0)...
+		};
+	}
+
+	template<size_t... Is>
+	void moveImpl(size_t target, size_t source, std::index_sequence<Is...>)
+	{
+		using dummy = int[];
+		(void)dummy {
+			0, (*getField<Is>(target) = *getField<Is>(source), 0)...
+		};
+	}
+
+	template<size_t... Is>
+	void swapImpl(size_t first, size_t second, std::index_sequence<Is...>)
+	{
+		using dummy = int[];
+		(void)dummy {
+			0, (std::swap(*getField<Is>(first), *getField<Is>(second)), 0)...
+		};
+	}
+
+	template<typename Self, typename Func, size_t... Is>
+	static void visitImpl(Self& self, size_t begin, size_t end, Func& func, std::index_sequence<Is...>)
+	{
+		const uint32_t* entityIndices = self.getEntityIndices().data();
+
+		while (begin < end) {
+			const size_t chunk = begin / ChunkSize;
+			const size_t offset = begin % ChunkSize;
+			const size_t count = std::min(end, (chunk + 1) * ChunkSize) - begin;
+
+			func(entityIndices + begin, count, (self.template getStream<Is>(chunk) + offset)...);
+
+			begin += count;
+		}
+	}
+};
+
+
+// Selects pool which stores component, components are stored in layout
+// declared by SoALayout. Specialized for components with own storage
+template<typename T>
+struct ComponentPoolTraits
+{
+	typedef typename std::conditional<SoALayout<T>::isSoA, SoAPool<T>, Pool<T>>::type Type;
+};
+
+template<typename T>
+using ComponentPool = typename ComponentPoolTraits<T>::Type;
\ No newline at end of file
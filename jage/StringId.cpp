@@ -0,0 +1,45 @@
+#include "StringId.h"
+
+#include <unordered_map>
+#include <stdexcept>
+#include <mutex>
+
+namespace
+{
+	std::mutex& getMutex()
+	{
+		static std::mutex mutex;
+		return mutex;
+	}
+
+	// interned strings, references to them stay valid on insertion
+	std::unordered_map<uint64_t, std::string>& getStrings()
+	{
+		static std::unordered_map<uint64_t, std::string> strings;
+		return strings;
+	}
+}
+
+StringId StringId::intern(const std::string & string)
+{
+	StringId id(string);
+
+	std::lock_guard<std::mutex> lock(getMutex());
+
+	auto it = getStrings().emplace(id.m_hash, string).first;
+	if (it->second != string) {
+		throw std::runtime_error("Unable to intern string: \"" + string + "\" has the same id as \"" + it->second + "\"");
+	}
+
+	return id;
+}
+
+const std::string & StringId::getString() const
+{
+	static const std::string empty;
+
+	std::lock_guard<std::mutex> lock(getMutex());
+
+	auto it = getStrings().find(m_hash);
+	return it != getStrings().end() ? it->second : empty;
+}
\ No newline at end of file
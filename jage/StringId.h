@@ -0,0 +1,76 @@
+#pragma once
+
+#include <functional>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Identifier of string which is compared and hashed as 64 bit integer
+// Id is 64 bit FNV-1a hash, so ids of literals can be computed at compile
+// time and collisions are unlikely even for millions of strings:
+//
+// constexpr StringId MESH_SHADER("mesh_shader");
+//
+// Strings are registered by intern to get them back by id
+class StringId
+{
+public:
+	constexpr StringId() :
+		m_hash(hash("", 0))
+	{}
+
+	constexpr StringId(const char* string) :
+		m_hash(hash(string, length(string)))
+	{}
+
+	StringId(const std::string& string) :
+		m_hash(hash(string.data(), string.size()))
+	{}
+
+	// Returns id of string and remembers string
+	// Throws std::runtime_error if other string with the same id was interned
+	static StringId intern(const std::string& string);
+
+	// Returns interned string or empty string if it wasn't interned
+	const std::string& getString() const;
+
+	constexpr uint64_t getHash() const { return m_hash; }
+
+	constexpr bool operator==(StringId other) const { return m_hash == other.m_hash; }
+	constexpr bool operator!=(StringId other) const { return m_hash != other.m_hash; }
+	constexpr bool operator<(StringId other) const { return m_hash < other.m_hash; }
+
+	static constexpr uint64_t hash(const char* data, size_t size)
+	{
+		uint64_t result = 14695981039346656037ull;
+		for (size_t i = 0; i < size; ++i) {
+			result = (result ^ static_cast<uint8_t>(data[i])) * 1099511628211ull;
+		}
+		return result;
+	}
+
+private:
+	static constexpr size_t length(const char* string)
+	{
+		size_t result = 0;
+		while (string[result] != '\0') {
+			++result;
+		}
+		return result;
+	}
+
+	uint64_t m_hash;
+};
+
+
+namespace std
+{
+	template<>
+	struct hash<StringId>
+	{
+		size_t operator()(StringId id) const
+		{
+			return static_cast<size_t>(id.getHash());
+		}
+	};
+}
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "TransformSystem.h"
+
+#include <glm/simd/matrix.h>
+
+#include "GameObject.h"
+
+namespace
+{
+	const mat4 IDENTITY(1.0f);
+
+	// result = parent * local
+	inline void multiply(const mat4& parent, const mat4& local, mat4& result)
+	{
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+		glm_vec4 a[4], b[4], c[4];
+		for (glm::length_t i = 0; i < 4; ++i) {
+			a[i] = _mm_loadu_ps(&parent[i][0]);
+			b[i] = _mm_loadu_ps(&local[i][0]);
+		}
+
+		glm_mat4_mul(a, b, c);
+
+		for (glm::length_t i = 0; i < 4; ++i) {
+			_mm_storeu_ps(&result[i][0], c[i]);
+		}
+#else
+		result = parent * local;
+#endif
+	}
+}
+
+const size_t TransformSystem::GRAIN_SIZE;
+
+TransformSystem::TransformSystem() :
+	m_hierarchyVersion(0), m_isRebuilt(false)
+{
+	// only game objects are used, systems which need world
+	// transformations declare dependency on this one
+	reads<>();
+}
+
+void TransformSystem::update(const float /*dt*/)
+{
+	if (m_hierarchyVersion != m_manager->getHierarchyVersion()) {
+		rebuild();
+	}
+
+	for (size_t level = 0; level + 1 < m_levels.size(); ++level) {
+		const size_t begin = m_levels[level];
+		JobSystem::parallelFor(m_levels[level + 1] - begin, GRAIN_SIZE, [this, begin](size_t first, size_t last) {
+			updateRange(begin + first, begin + last);
+		});
+	}
+
+	m_isRebuilt = false;
+}
+
+const mat4 & TransformSystem::getWorldTransformation(EntityId id) const
+{
+	const uint32_t index = id.getIndex();
+	if (index < m_positions.size() && m_positions[index] != BasePool::INVALID_INDEX) {
+		return m_worldTransformations[m_positions[index]];
+	}
+	return IDENTITY;
+}
+
+bool TransformSystem::isWorldTransformationChanged(EntityId id) const
+{
+	const uint32_t index = id.getIndex();
+	return index < m_positions.size() && m_positions[index] != BasePool::INVALID_INDEX &&
+		m_changed[m_positions[index]] != 0;
+}
+
+size_t TransformSystem::getSize() const
+{
+	return m_objects.size();
+}
+
+size_t TransformSystem::getLevelCount() const
+{
+	return m_levels.empty() ? 0 : m_levels.size() - 1;
+}
+
+void TransformSystem::updateRange(size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; ++i) {
+		GameObject* object = m_objects[i];
+		const uint32_t parent = m_parents[i];
+
+		bool changed = m_isRebuilt || object->m_isTransformDirty;
+		if (changed) {
+			m_localTransformations[i] = object->getTransformationMatrix();
+			object->m_isTransformDirty = false;
+		}
+
+		if (parent == BasePool::INVALID_INDEX) {
+			if (changed) {
+				m_worldTransformations[i] = m_localTransformations[i];
+			}
+		}
+		else if (changed || m_changed[parent]) {
+			multiply(m_worldTransformations[parent], m_localTransformations[i], m_worldTransformations[i]);
+			changed = true;
+		}
+
+		m_changed[i] = changed;
+	}
+}
+
+void TransformSystem::rebuild()
+{
+	const uint32_t capacity = static_cast<uint32_t>(m_manager->getCapacity());
+
+	m_objects.clear();
+	m_parents.clear();
+	m_levels.clear();
+	m_positions.assign(capacity, BasePool::INVALID_INDEX);
+
+	// roots go first, then objects are added level by level
+	for (uint32_t index = 0; index < capacity; ++index) {
+		GameObject* object = m_manager->getObject(m_manager->createId(index));
+		if (object == nullptr || !object->isValid()) {
+			continue;
+		}
+
+		if (object->getParent() == nullptr) {
+			m_positions[index] = static_cast<uint32_t>(m_objects.size());
+			m_objects.push_back(object);
+			m_parents.push_back(BasePool::INVALID_INDEX);
+		}
+	}
+
+	// children of the current level form the next one
+	m_levels.push_back(0);
+	while (m_levels.back() < m_objects.size()) {
+		const size_t levelBegin = m_levels.back();
+		const size_t levelEnd = m_objects.size();
+
+		for (size_t i = levelBegin; i < levelEnd; ++i) {
+			for (GameObject* child = m_objects[i]->getFirstChild(); child != nullptr; child = child->getNextSibling()) {
+				m_positions[child->getId().getIndex()] = static_cast<uint32_t>(m_objects.size());
+				m_objects.push_back(child);
+				m_parents.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		m_levels.push_back(levelEnd);
+	}
+
+	m_localTransformations.resize(m_objects.size());
+	m_worldTransformations.resize(m_objects.size());
+	m_changed.resize(m_objects.size());
+
+	m_hierarchyVersion = m_manager->getHierarchyVersion();
+	m_isRebuilt = true;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <vector>
+
+#include "EntityManager.h"
+#include "Math.h"
+
+// Keeps local and world transformations of all game objects
+// Objects are stored in contiguous arrays ordered by depth, so each parent
+// is placed before its children. Order is rebuilt only when hierarchy
+// changes, world transformations are recalculated only for objects whose
+// transformation or transformation of some ancestor has changed
+// Objects of one depth level depend only on previous levels, so each
+// level is updated in parallel by JobSystem
+class TransformSystem : public EntitySystem
+{
+public:
+	// Number of objects of one level which are updated by one job
+	static const size_t GRAIN_SIZE = 1024;
+
+	TransformSystem();
+
+	void update(const float dt) override;
+
+	// Returns world transformation calculated by the last update
+	// Identity is returned for entities without game object
+	const mat4& getWorldTransformation(EntityId id) const;
+
+	// Returns true if world transformation was changed by the last update
+	bool isWorldTransformationChanged(EntityId id) const;
+
+	size_t getSize() const;
+	size_t getLevelCount() const;
+
+private:
+	void rebuild();
+	void updateRange(size_t begin, size_t end);
+
+	uint32_t m_hierarchyVersion;
+	bool m_isRebuilt;
+
+	// dense position of each entity index or INVALID_INDEX
+	std::vector<uint32_t> m_positions;
+
+	// dense position of the first object of each level and the end
+	std::vector<size_t> m_levels;
+
+	std::vector<GameObject*> m_objects;
+	std::vector<uint32_t> m_parents;
+	std::vector<mat4> m_localTransformations;
+	std::vector<mat4> m_worldTransformations;
+	std::vector<uint8_t> m_changed;
+};
\ No newline at end of file
@@ -0,0 +1,501 @@
+#include "WorldSnapshot.h"
+
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "GameObject.h"
+#include "Log.h"
+
+namespace
+{
+	const uint32_t SNAPSHOT_MAGIC = 0x504E534A; // "JSNP"
+	const uint32_t SNAPSHOT_VERSION = 2;
+
+	// number of game objects which are constructed at once on load
+	const uint32_t OBJECT_BATCH_SIZE = 256;
+
+	// Arrays are read in place from mapped file. They can be unaligned,
+	// so elements are copied out of them
+	template<typename T>
+	const char* skipArray(SnapshotReader& reader, size_t count)
+	{
+		return reader.skip(count * sizeof(T));
+	}
+
+	template<typename T>
+	T readElement(const char* array, size_t index)
+	{
+		T value;
+		std::memcpy(&value, array + index * sizeof(T), sizeof(T));
+		return value;
+	}
+
+	template<typename T>
+	void writeArray(SnapshotWriter& writer, const std::vector<T>& values)
+	{
+		writer.write(values.data(), values.size() * sizeof(T));
+	}
+
+	// Read only view of the whole file
+	class MappedFile
+	{
+	public:
+		MappedFile(const std::string& path) :
+			m_data(nullptr), m_size(0)
+		{
+#ifdef _WIN32
+			m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE) {
+				throw std::runtime_error("Unable to open snapshot: \"" + path + "\"");
+			}
+
+			LARGE_INTEGER size;
+			GetFileSizeEx(m_file, &size);
+			m_size = static_cast<size_t>(size.QuadPart);
+
+			m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (m_mapping != nullptr) {
+				m_data = static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+			}
+#else
+			m_file = open(path.c_str(), O_RDONLY);
+			if (m_file < 0) {
+				throw std::runtime_error("Unable to open snapshot: \"" + path + "\"");
+			}
+
+			struct stat info;
+			fstat(m_file, &info);
+			m_size = static_cast<size_t>(info.st_size);
+
+			if (m_size > 0) {
+				void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_file, 0);
+				if (data != MAP_FAILED) {
+					m_data = static_cast<const char*>(data);
+				}
+			}
+#endif
+
+			if (m_data == nullptr) {
+				close();
+				throw std::runtime_error("Unable to map snapshot: \"" + path + "\"");
+			}
+		}
+
+		~MappedFile()
+		{
+			close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const char* getData() const { return m_data; }
+		size_t getSize() const { return m_size; }
+
+	private:
+		void close()
+		{
+#ifdef _WIN32
+			if (m_data != nullptr) {
+				UnmapViewOfFile(m_data);
+			}
+			if (m_mapping != nullptr) {
+				CloseHandle(m_mapping);
+			}
+			CloseHandle(m_file);
+#else
+			if (m_data != nullptr) {
+				munmap(const_cast<char*>(m_data), m_size);
+			}
+			::close(m_file);
+#endif
+			m_data = nullptr;
+		}
+
+#ifdef _WIN32
+		HANDLE m_file;
+		HANDLE m_mapping = nullptr;
+#else
+		int m_file;
+#endif
+		const char* m_data;
+		size_t m_size;
+	};
+}
+
+
+void SnapshotWriter::write(const void * data, size_t size)
+{
+	const char* bytes = static_cast<const char*>(data);
+	m_data.insert(m_data.end(), bytes, bytes + size);
+}
+
+void SnapshotWriter::writeString(const std::string & value)
+{
+	write(static_cast<uint32_t>(value.size()));
+	write(value.data(), value.size());
+}
+
+void SnapshotWriter::reserve(size_t size)
+{
+	m_data.reserve(m_data.size() + size);
+}
+
+size_t SnapshotWriter::getPosition() const
+{
+	return m_data.size();
+}
+
+void SnapshotWriter::patch(size_t position, const void * data, size_t size)
+{
+	std::memcpy(m_data.data() + position, data, size);
+}
+
+const std::vector<char>& SnapshotWriter::getData() const
+{
+	return m_data;
+}
+
+
+SnapshotReader::SnapshotReader(const char * data, size_t size) :
+	m_data(data), m_size(size), m_position(0)
+{
+}
+
+void SnapshotReader::read(void * data, size_t size)
+{
+	std::memcpy(data, skip(size), size);
+}
+
+std::string SnapshotReader::readString()
+{
+	const uint32_t size = read<uint32_t>();
+	const char* data = skip(size);
+	return std::string(data, size);
+}
+
+const char * SnapshotReader::skip(size_t size)
+{
+	if (size > m_size - m_position) {
+		throw std::runtime_error("Unable to read snapshot. Unexpected end of data");
+	}
+
+	const char* data = m_data + m_position;
+	m_position += size;
+	return data;
+}
+
+
+std::vector<WorldSnapshot::Entry> WorldSnapshot::m_entries;
+
+void WorldSnapshot::unregisterAll()
+{
+	m_entries.clear();
+}
+
+void WorldSnapshot::save(const EntityManager & manager, const std::string & path)
+{
+	SnapshotWriter writer;
+
+	writer.write(SNAPSHOT_MAGIC);
+	writer.write(SNAPSHOT_VERSION);
+
+	// entities
+	const uint32_t capacity = static_cast<uint32_t>(manager.getCapacity());
+	writer.write(capacity);
+	writer.write(manager.m_entityVersions.data(), capacity * sizeof(uint32_t));
+	writer.write(static_cast<uint32_t>(manager.m_aliveEntities.size()));
+	writer.write(manager.m_aliveEntities.data(), manager.m_aliveEntities.size() * sizeof(uint64_t));
+
+	saveObjects(manager, writer);
+
+	// components, each section has its size so unknown ones can be skipped
+	const size_t sectionCountPosition = writer.getPosition();
+	uint32_t sectionCount = 0;
+	writer.write(sectionCount);
+
+	for (const auto& entry : m_entries) {
+		SnapshotWriter section;
+		if (!entry.save(manager, section)) {
+			continue;
+		}
+
+		writer.writeString(entry.name);
+		writer.write(entry.type);
+		writer.write(static_cast<uint64_t>(section.getData().size()));
+		writer.write(section.getData().data(), section.getData().size());
+		++sectionCount;
+	}
+
+	writer.patch(sectionCountPosition, &sectionCount, sizeof(sectionCount));
+
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) {
+		throw std::runtime_error("Unable to save snapshot: \"" + path + "\"");
+	}
+	file.write(writer.getData().data(), writer.getData().size());
+}
+
+void WorldSnapshot::load(EntityManager & manager, const std::string & path)
+{
+	MappedFile file(path);
+	SnapshotReader reader(file.getData(), file.getSize());
+
+	if (reader.read<uint32_t>() != SNAPSHOT_MAGIC || reader.read<uint32_t>() != SNAPSHOT_VERSION) {
+		throw std::runtime_error("Unable to load snapshot: \"" + path + "\". Unsupported format");
+	}
+
+	restoreEntities(manager, reader);
+
+	const uint32_t sectionCount = reader.read<uint32_t>();
+	for (uint32_t i = 0; i < sectionCount; ++i) {
+		const std::string name = reader.readString();
+		const SectionType type = reader.read<SectionType>();
+		const uint64_t size = reader.read<uint64_t>();
+
+		SnapshotReader section(reader.skip(size), size);
+
+		auto it = std::find_if(m_entries.begin(), m_entries.end(), [&name](const Entry& entry) {
+			return entry.name == name;
+		});
+
+		if (it == m_entries.end() || it->type != type) {
+			Log::write("WARNING: component \"" + name + "\" of snapshot is not registered. It is skipped");
+			continue;
+		}
+
+		it->load(manager, section);
+	}
+}
+
+void WorldSnapshot::addEntry(Entry entry)
+{
+	auto it = std::find_if(m_entries.begin(), m_entries.end(), [&entry](const Entry& item) {
+		return item.name == entry.name;
+	});
+
+	if (it != m_entries.end()) {
+		*it = std::move(entry);
+	}
+	else {
+		m_entries.push_back(std::move(entry));
+	}
+}
+
+void WorldSnapshot::saveChunks(const BasePool & pool, SnapshotWriter & writer)
+{
+	const std::vector<uint32_t>& entities = pool.getEntityIndices();
+	const size_t chunkBytes = pool.getElementSize() * pool.getChunkSize();
+	const size_t chunkCount = (entities.size() + pool.getChunkSize() - 1) / pool.getChunkSize();
+
+	writer.write(static_cast<uint32_t>(pool.getElementSize()));
+	writer.write(static_cast<uint32_t>(pool.getChunkSize()));
+	writer.write(static_cast<uint32_t>(entities.size()));
+	writer.write(entities.data(), entities.size() * sizeof(uint32_t));
+
+	// chunks are written whole, so layout of pool doesn't matter
+	for (size_t i = 0; i < chunkCount; ++i) {
+		writer.write(pool.getChunk(i), chunkBytes);
+	}
+}
+
+void WorldSnapshot::loadChunks(EntityManager & manager, BasePool * pool, size_t family, SnapshotReader & reader)
+{
+	const uint32_t elementSize = reader.read<uint32_t>();
+	const uint32_t chunkSize = reader.read<uint32_t>();
+	const uint32_t count = reader.read<uint32_t>();
+
+	if (elementSize != pool->getElementSize() || chunkSize != pool->getChunkSize()) {
+		throw std::runtime_error("Unable to load snapshot. Layout of component pool has changed");
+	}
+
+	const char* entities = reader.skip(count * sizeof(uint32_t));
+	const size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	const char* chunks = reader.skip(chunkCount * chunkSize * elementSize);
+
+	pool->assignChunks(entities, count, chunks, manager.m_changeVersion);
+
+	manager.setComponentFlags(pool->getEntityIndices().data(), count, family);
+}
+
+void WorldSnapshot::restoreEntities(EntityManager & manager, SnapshotReader & reader)
+{
+	// current entities are destroyed, so all pools become empty
+	std::vector<EntityId> entities;
+	manager.each<>([&entities](EntityId id) {
+		entities.push_back(id);
+	});
+	manager.destroyMany(entities);
+
+	const uint32_t capacity = reader.read<uint32_t>();
+
+	manager.m_currentIndex = capacity;
+	manager.m_entityComponentMasks.assign(capacity, EntityManager::ComponentMask());
+	manager.m_entityVersions.resize(capacity);
+	reader.read(manager.m_entityVersions.data(), capacity * sizeof(uint32_t));
+	manager.m_gameObjects.clear();
+	manager.m_gameObjects.reserve(capacity);
+	++manager.m_hierarchyVersion;
+
+	const uint32_t wordCount = reader.read<uint32_t>();
+	manager.m_aliveEntities.resize(wordCount);
+	reader.read(manager.m_aliveEntities.data(), wordCount * sizeof(uint64_t));
+	for (auto& bitmap : manager.m_componentBitmaps) {
+		bitmap.assign(wordCount, 0);
+	}
+
+	// free indices are reused lowest first
+	manager.m_availableIndices.clear();
+	for (uint32_t word = 0; word < wordCount; ++word) {
+		for (uint64_t bits = ~manager.m_aliveEntities[word]; bits != 0; bits &= bits - 1) {
+			const uint32_t index = static_cast<uint32_t>(word * 64 + detail::countTrailingZeros(bits));
+			if (index >= capacity) {
+				break;
+			}
+
+			manager.m_availableIndices.push_back(index);
+		}
+	}
+	std::make_heap(manager.m_availableIndices.begin(), manager.m_availableIndices.end(), std::greater<uint32_t>());
+
+	restoreObjects(manager, reader);
+}
+
+void WorldSnapshot::saveObjects(const EntityManager & manager, SnapshotWriter & writer)
+{
+	const GameObjectPool& pool = manager.m_gameObjects;
+
+	// objects of alive entities in order of their indices
+	std::vector<uint32_t> indices;
+	for (size_t word = 0; word < manager.m_aliveEntities.size(); ++word) {
+		for (uint64_t bits = manager.m_aliveEntities[word]; bits != 0; bits &= bits - 1) {
+			const uint32_t index = static_cast<uint32_t>(word * 64 + detail::countTrailingZeros(bits));
+			if (pool.get(index) != nullptr) {
+				indices.push_back(index);
+			}
+		}
+	}
+
+	// each field is written as array, names and tags refer to
+	// table of distinct strings
+	std::vector<uint8_t> active(indices.size());
+	std::vector<uint32_t> names(indices.size());
+	std::vector<uint32_t> tags(indices.size());
+	std::vector<vec3> positions(indices.size());
+	std::vector<quat> rotations(indices.size());
+	std::vector<vec3> scales(indices.size());
+	std::vector<HierarchyNode> nodes(indices.size());
+
+	std::vector<StringId> strings;
+	std::unordered_map<StringId, uint32_t> stringIndices;
+	auto getStringIndex = [&strings, &stringIndices](StringId id) {
+		auto result = stringIndices.try_emplace(id, static_cast<uint32_t>(strings.size()));
+		if (result.second) {
+			strings.push_back(id);
+		}
+		return result.first->second;
+	};
+
+	for (size_t i = 0; i < indices.size(); ++i) {
+		const GameObject* gameObject = pool.get(indices[i]);
+		active[i] = static_cast<uint8_t>(gameObject->isActive());
+		names[i] = getStringIndex(gameObject->getNameId());
+		tags[i] = getStringIndex(gameObject->getTagId());
+		positions[i] = gameObject->m_position;
+		rotations[i] = gameObject->m_rotation;
+		scales[i] = gameObject->m_scale;
+		nodes[i] = pool.getNode(indices[i]);
+	}
+
+	writer.reserve(indices.size() * (sizeof(uint32_t) * 3 + sizeof(uint8_t) +
+		sizeof(vec3) * 2 + sizeof(quat) + sizeof(HierarchyNode)));
+
+	writer.write(static_cast<uint32_t>(indices.size()));
+	writeArray(writer, indices);
+
+	writer.write(static_cast<uint32_t>(strings.size()));
+	for (auto id : strings) {
+		writer.writeString(id.getString());
+	}
+
+	writeArray(writer, active);
+	writeArray(writer, names);
+	writeArray(writer, tags);
+	writeArray(writer, positions);
+	writeArray(writer, rotations);
+	writeArray(writer, scales);
+	writeArray(writer, nodes);
+}
+
+void WorldSnapshot::restoreObjects(EntityManager & manager, SnapshotReader & reader)
+{
+	GameObjectPool& pool = manager.m_gameObjects;
+
+	const uint32_t count = reader.read<uint32_t>();
+	const char* indices = skipArray<uint32_t>(reader, count);
+
+	std::vector<StringId> strings(reader.read<uint32_t>());
+	for (auto& id : strings) {
+		id = StringId::intern(reader.readString());
+	}
+
+	const char* active = skipArray<uint8_t>(reader, count);
+	const char* names = skipArray<uint32_t>(reader, count);
+	const char* tags = skipArray<uint32_t>(reader, count);
+	const char* positions = skipArray<vec3>(reader, count);
+	const char* rotations = skipArray<quat>(reader, count);
+	const char* scales = skipArray<vec3>(reader, count);
+	const char* nodes = skipArray<HierarchyNode>(reader, count);
+
+	// objects are constructed in batches and filled while they are in cache
+	// Fields and links are copied as is, so nothing is relinked or marked
+	// by setters
+	EntityId ids[OBJECT_BATCH_SIZE];
+	GameObject* objects[OBJECT_BATCH_SIZE];
+
+	for (uint32_t begin = 0; begin < count; begin += OBJECT_BATCH_SIZE) {
+		const uint32_t batchSize = std::min(count - begin, OBJECT_BATCH_SIZE);
+
+		for (uint32_t i = 0; i < batchSize; ++i) {
+			const uint32_t index = readElement<uint32_t>(indices, begin + i);
+			if (index >= manager.getCapacity()) {
+				throw std::runtime_error("Unable to load snapshot. Game objects are corrupted");
+			}
+			ids[i] = manager.createId(index);
+		}
+
+		pool.constructMany(&manager, ids, batchSize, objects);
+
+		for (uint32_t i = 0; i < batchSize; ++i) {
+			const uint32_t name = readElement<uint32_t>(names, begin + i);
+			const uint32_t tag = readElement<uint32_t>(tags, begin + i);
+			if (name >= strings.size() || tag >= strings.size()) {
+				throw std::runtime_error("Unable to load snapshot. Game objects are corrupted");
+			}
+
+			GameObject* gameObject = objects[i];
+			gameObject->m_isActive = readElement<uint8_t>(active, begin + i) != 0;
+			gameObject->m_tag = strings[tag];
+			gameObject->m_position = readElement<vec3>(positions, begin + i);
+			gameObject->m_rotation = readElement<quat>(rotations, begin + i);
+			gameObject->m_scale = readElement<vec3>(scales, begin + i);
+
+			const uint32_t index = ids[i].getIndex();
+			if (strings[name] != StringId()) {
+				pool.setName(index, strings[name]);
+			}
+			pool.setNode(index, readElement<HierarchyNode>(nodes, begin + i));
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <type_traits>
+#include <functional>
+#include <stdexcept>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "EntityManager.h"
+
+// Binary buffer which snapshot is written to
+class SnapshotWriter
+{
+public:
+	void write(const void* data, size_t size);
+
+	template<typename T>
+	void write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be written as is");
+		write(&value, sizeof(T));
+	}
+
+	void writeString(const std::string& value);
+
+	// Makes room for size more bytes
+	void reserve(size_t size);
+
+	// Returns position which can be patched later
+	size_t getPosition() const;
+	void patch(size_t position, const void* data, size_t size);
+
+	const std::vector<char>& getData() const;
+
+private:
+	std::vector<char> m_data;
+};
+
+
+// Reads snapshot data without copying it
+// Throws std::runtime_error if data ends unexpectedly
+class SnapshotReader
+{
+public:
+	SnapshotReader(const char* data, size_t size);
+
+	void read(void* data, size_t size);
+
+	template<typename T>
+	T read()
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "Only trivially copyable values can be read as is");
+		T value;
+		read(&value, sizeof(T));
+		return value;
+	}
+
+	std::string readString();
+
+	// Returns pointer to the next size bytes and moves past them
+	const char* skip(size_t size);
+
+private:
+	const char* m_data;
+	size_t m_size;
+	size_t m_position;
+};
+
+
+// Saves and restores entities, their components and GameObject state
+// Components are identified by registered names, because component
+// families depend on the order of their first use. Trivially copyable
+// components are stored as raw pool chunks and copied back as is,
+// other ones are stored through registered serializers. Components
+// which are not registered are skipped
+// Snapshot file is memory mapped on load
+class WorldSnapshot
+{
+public:
+	// Registers component which is stored as raw pool chunks
+	template<typename T>
+	static void registerComponent(const std::string& name)
+	{
+		static_assert((std::is_same<ComponentPool<T>, Pool<T>>::value && std::is_trivially_copyable<T>::value) ||
+			SoALayout<T>::isSoA, "Only trivially copyable components can be stored as raw chunks");
+
+		Entry entry;
+		entry.name = name;
+		entry.type = RAW_CHUNKS;
+
+		entry.save = [](const EntityManager& manager, SnapshotWriter& writer) {
+			const BasePool* pool = manager.getPool<T>();
+			if (pool == nullptr) {
+				return false;
+			}
+
+			saveChunks(*pool, writer);
+			return true;
+		};
+
+		entry.load = [](EntityManager& manager, SnapshotReader& reader) {
+			loadChunks(manager, manager.accommodate<T>(), EntityManager::getComponentFamily<T>(), reader);
+		};
+
+		addEntry(std::move(entry));
+	}
+
+	// Registers component which is stored through serializer
+	template<typename T>
+	static void registerComponent(const std::string& name,
+		std::function<void(SnapshotWriter&, const T&)> serialize, std::function<T(SnapshotReader&)> deserialize)
+	{
+		Entry entry;
+		entry.name = name;
+		entry.type = SERIALIZED;
+
+		entry.save = [serialize](const EntityManager& manager, SnapshotWriter& writer) {
+			const auto* pool = manager.getPool<T>();
+			if (pool == nullptr) {
+				return false;
+			}
+
+			const std::vector<uint32_t>& entities = pool->getEntityIndices();
+			writer.write(static_cast<uint32_t>(entities.size()));
+			writer.write(entities.data(), entities.size() * sizeof(uint32_t));
+			for (size_t i = 0; i < entities.size(); ++i) {
+				serialize(writer, pool->load(i));
+			}
+			return true;
+		};
+
+		entry.load = [deserialize](EntityManager& manager, SnapshotReader& reader) {
+			const uint32_t count = reader.read<uint32_t>();
+			const uint32_t* entities = reinterpret_cast<const uint32_t*>(reader.skip(count * sizeof(uint32_t)));
+
+			manager.accommodate<T>()->reserve(count);
+			for (uint32_t i = 0; i < count; ++i) {
+				uint32_t index;
+				std::memcpy(&index, entities + i, sizeof(uint32_t));
+				manager.assign<T>(manager.createId(index), deserialize(reader));
+			}
+		};
+
+		addEntry(std::move(entry));
+	}
+
+	static void unregisterAll();
+
+	// Writes all entities of manager to file
+	static void save(const EntityManager& manager, const std::string& path);
+
+	// Replaces all entities of manager with entities from file
+	// Entities get the same ids they had when snapshot was saved
+	// Throws std::runtime_error if file can't be read
+	static void load(EntityManager& manager, const std::string& path);
+
+private:
+	enum SectionType : uint8_t
+	{
+		RAW_CHUNKS,
+		SERIALIZED
+	};
+
+	struct Entry
+	{
+		std::string name;
+		SectionType type;
+
+		// returns false if there is nothing to save
+		std::function<bool(const EntityManager&, SnapshotWriter&)> save;
+		std::function<void(EntityManager&, SnapshotReader&)> load;
+	};
+
+	static void addEntry(Entry entry);
+
+	static void saveChunks(const BasePool& pool, SnapshotWriter& writer);
+	static void loadChunks(EntityManager& manager, BasePool* pool, size_t family, SnapshotReader& reader);
+
+	static void restoreEntities(EntityManager& manager, SnapshotReader& reader);
+
+	static void saveObjects(const EntityManager& manager, SnapshotWriter& writer);
+	static void restoreObjects(EntityManager& manager, SnapshotReader& reader);
+
+	static std::vector<Entry> m_entries;
+};
\ No newline at end of file
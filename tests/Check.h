@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdexcept>
+#include <string>
+#include <chrono>
+
+// Throws if condition is false, test runner reports failed test
+#define CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			throw std::runtime_error(std::string("Check failed: ") + #condition + \
+				" (" + __FILE__ + ":" + std::to_string(__LINE__) + ")"); \
+		} \
+	} while (false)
+
+// Measures time since construction
+class Stopwatch
+{
+public:
+	Stopwatch() : m_start(std::chrono::steady_clock::now()) {}
+
+	double getMilliseconds() const
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_start;
+};
\ No newline at end of file
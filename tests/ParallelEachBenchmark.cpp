@@ -0,0 +1,91 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+#include "EntityManager.h"
+
+#include "Check.h"
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	const int ITERATION_COUNT = 10;
+
+	// Some work per entity, so iteration isn't bound only by memory
+	inline void integrate(Position& position, const Velocity& velocity)
+	{
+		const float length = std::sqrt(velocity.x * velocity.x + velocity.y * velocity.y + velocity.z * velocity.z);
+		const float scale = 0.016f / (1.0f + length);
+		position.x += velocity.x * scale + std::sin(position.y) * 0.001f;
+		position.y += velocity.y * scale + std::cos(position.x) * 0.001f;
+		position.z += velocity.z * scale;
+	}
+
+	template<typename Func>
+	double measure(Func&& func)
+	{
+		func();
+
+		Stopwatch time;
+		for (int i = 0; i < ITERATION_COUNT; ++i) {
+			func();
+		}
+		return time.getMilliseconds() / ITERATION_COUNT;
+	}
+}
+
+void runParallelEachBenchmark(size_t entityCount)
+{
+	EntityManager manager;
+	for (auto id : manager.createMany(entityCount)) {
+		const float index = static_cast<float>(id.getIndex());
+		manager.assign<Position>(id, Position{ index, 0.0f, 0.0f });
+		manager.assign<Velocity>(id, Velocity{ 1.0f, index * 0.001f, 0.5f });
+	}
+
+	const double serialMilliseconds = measure([&manager]() {
+		manager.each<Position, const Velocity>([](EntityId, Position& position, const Velocity& velocity) {
+			integrate(position, velocity);
+		});
+	});
+	std::printf("parallelEach: %zu entities, each %.2f ms\n", entityCount, serialMilliseconds);
+
+	// 1, 2, 4... threads and all hardware threads
+	const size_t maxThreadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	std::vector<size_t> threadCounts;
+	for (size_t threadCount = 1; threadCount < maxThreadCount; threadCount *= 2) {
+		threadCounts.push_back(threadCount);
+	}
+	threadCounts.push_back(maxThreadCount);
+
+	for (auto threadCount : threadCounts) {
+		// without workers jobs run on the calling thread
+		if (threadCount > 1) {
+			JobSystem::init(threadCount - 1);
+		}
+
+		const double parallelMilliseconds = measure([&manager]() {
+			manager.parallelEach<Position, const Velocity>([](EntityId, Position& position, const Velocity& velocity) {
+				integrate(position, velocity);
+			});
+		});
+
+		JobSystem::close();
+
+		std::printf("parallelEach: %zu threads %.2f ms, speedup %.2f\n",
+			threadCount, parallelMilliseconds, serialMilliseconds / parallelMilliseconds);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "WorldSnapshot.h"
+#include "GameObject.h"
+
+#include "Check.h"
+
+namespace
+{
+	struct Position
+	{
+		float x, y, z;
+	};
+
+	struct Velocity
+	{
+		float x, y, z;
+	};
+
+	struct Label
+	{
+		std::string text;
+	};
+
+	const char* SNAPSHOT_PATH = "snapshot_test.bin";
+
+	void registerComponents()
+	{
+		WorldSnapshot::registerComponent<Position>("Position");
+		WorldSnapshot::registerComponent<Velocity>("Velocity");
+		WorldSnapshot::registerComponent<Label>("Label",
+			[](SnapshotWriter& writer, const Label& label) { writer.writeString(label.text); },
+			[](SnapshotReader& reader) { return Label{ reader.readString() }; });
+	}
+
+	Position getPosition(EntityId id)
+	{
+		const float index = static_cast<float>(id.getIndex());
+		return Position{ index, index * 2.0f, static_cast<float>(id.getVersion()) };
+	}
+
+	void assignComponents(EntityManager& manager, EntityId id)
+	{
+		const uint32_t index = id.getIndex();
+
+		manager.assign<Position>(id, getPosition(id));
+		if (index % 2 == 0) {
+			manager.assign<Velocity>(id, Velocity{ 1.0f, 0.0f, static_cast<float>(index) });
+		}
+		if (index % 5 == 0) {
+			manager.assign<Label>(id, Label{ "entity " + std::to_string(index) });
+		}
+	}
+
+	// Creates entities with components and hierarchy, some of them are
+	// destroyed and some indices are reused, so versions differ
+	std::vector<EntityId> createWorld(EntityManager& manager, size_t count)
+	{
+		std::vector<EntityId> entities = manager.createMany(count);
+		for (auto id : entities) {
+			assignComponents(manager, id);
+		}
+
+		// every 100th object gets 10 children
+		for (size_t i = 0; i + 10 < entities.size(); i += 100) {
+			GameObject* parent = manager.getObject(entities[i]);
+			parent->setName("parent " + std::to_string(i));
+			for (size_t j = 1; j <= 10; ++j) {
+				GameObject* child = manager.getObject(entities[i + j]);
+				child->setPosition(static_cast<float>(j), 0.0f, 0.0f);
+				child->setParent(parent);
+			}
+		}
+
+		std::vector<EntityId> destroyed;
+		for (size_t i = 3; i < entities.size(); i += 7) {
+			destroyed.push_back(entities[i]);
+		}
+		manager.destroyMany(destroyed);
+
+		std::vector<EntityId> reused = manager.createMany(destroyed.size() / 2);
+		for (auto id : reused) {
+			assignComponents(manager, id);
+		}
+
+		entities.insert(entities.end(), reused.begin(), reused.end());
+		return entities;
+	}
+
+	EntityId getParentId(const GameObject* object)
+	{
+		const GameObject* parent = object->getParent();
+		return parent != nullptr ? parent->getId() : EntityId::INVALID;
+	}
+}
+
+void runSnapshotTests()
+{
+	registerComponents();
+
+	EntityManager source;
+	source.group<Position, Velocity>();
+	std::vector<EntityId> entities = createWorld(source, 10000);
+
+	WorldSnapshot::save(source, SNAPSHOT_PATH);
+
+	// loaded world replaces everything target had before
+	EntityManager target;
+	target.group<Position, Velocity>();
+	for (auto id : target.createMany(100)) {
+		target.assign<Position>(id, Position{ -1.0f, -1.0f, -1.0f });
+	}
+
+	WorldSnapshot::load(target, SNAPSHOT_PATH);
+
+	CHECK(target.getSize() == source.getSize());
+	CHECK(target.getCapacity() == source.getCapacity());
+
+	for (uint32_t index = 0; index < source.getCapacity(); ++index) {
+		CHECK(target.createId(index) == source.createId(index));
+	}
+
+	for (auto id : entities) {
+		CHECK(target.isValid(id) == source.isValid(id));
+		if (!source.isValid(id)) {
+			continue;
+		}
+
+		CHECK(target.getComponentMask(id) == source.getComponentMask(id));
+
+		const Position position = target.getComponent<Position>(id).load();
+		const Position expected = getPosition(id);
+		CHECK(position.x == expected.x && position.y == expected.y && position.z == expected.z);
+
+		if (source.hasComponent<Velocity>(id)) {
+			CHECK(target.getComponent<Velocity>(id)->z == source.getComponent<Velocity>(id)->z);
+		}
+
+		if (source.hasComponent<Label>(id)) {
+			CHECK(target.getComponent<Label>(id)->text == source.getComponent<Label>(id)->text);
+		}
+
+		const GameObject* sourceObject = source.getObject(id);
+		const GameObject* targetObject = target.getObject(id);
+		CHECK(targetObject->getId() == id);
+		CHECK(targetObject->getName() == sourceObject->getName());
+		CHECK(targetObject->getPosition() == sourceObject->getPosition());
+		CHECK(getParentId(targetObject) == getParentId(sourceObject));
+
+		std::vector<GameObject*> sourceChildren = sourceObject->getChildren();
+		std::vector<GameObject*> targetChildren = targetObject->getChildren();
+		CHECK(targetChildren.size() == sourceChildren.size());
+		for (size_t i = 0; i < sourceChildren.size(); ++i) {
+			CHECK(targetChildren[i]->getId() == sourceChildren[i]->getId());
+		}
+	}
+
+	// owning group of target walks the same entities
+	size_t sourceCount = 0, targetCount = 0;
+	float sourceSum = 0.0f, targetSum = 0.0f;
+	source.each<const Position, const Velocity>([&](EntityId, const Position& position, const Velocity&) {
+		++sourceCount;
+		sourceSum += position.x;
+	});
+	target.each<const Position, const Velocity>([&](EntityId, const Position& position, const Velocity&) {
+		++targetCount;
+		targetSum += position.x;
+	});
+	CHECK(targetCount == sourceCount && targetSum == sourceSum);
+
+	// lowest free index is reused first, with the next version
+	std::vector<bool> isAlive(source.getCapacity(), false);
+	for (auto id : entities) {
+		if (source.isValid(id)) {
+			isAlive[id.getIndex()] = true;
+		}
+	}
+
+	const uint32_t lowestFree = static_cast<uint32_t>(std::find(isAlive.begin(), isAlive.end(), false) - isAlive.begin());
+	CHECK(lowestFree < source.getCapacity());
+
+	std::shared_ptr<GameObject> created = target.create();
+	CHECK(created->getId().getIndex() == lowestFree);
+	CHECK(created->getId().getVersion() == source.createId(lowestFree).getVersion());
+
+	WorldSnapshot::unregisterAll();
+	std::remove(SNAPSHOT_PATH);
+}
+
+void runSnapshotBenchmark(size_t entityCount)
+{
+	registerComponents();
+
+	EntityManager source;
+	createWorld(source, entityCount);
+
+	Stopwatch saveTime;
+	WorldSnapshot::save(source, SNAPSHOT_PATH);
+	const double saveMilliseconds = saveTime.getMilliseconds();
+
+	EntityManager target;
+	target.group<Position, Velocity>();
+
+	Stopwatch loadTime;
+	WorldSnapshot::load(target, SNAPSHOT_PATH);
+	const double loadMilliseconds = loadTime.getMilliseconds();
+
+	std::printf("snapshot: %zu entities, save %.1f ms, load %.1f ms\n",
+		source.getSize(), saveMilliseconds, loadMilliseconds);
+
+	WorldSnapshot::unregisterAll();
+	std::remove(SNAPSHOT_PATH);
+}
\ No newline at end of file
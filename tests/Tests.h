@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstddef>
+
+// Tests throw std::runtime_error on failure
+void runSnapshotTests();
+
+// Benchmarks print their results
+void runSnapshotBenchmark(size_t entityCount);
+void runParallelEachBenchmark(size_t entityCount);
+void runTransformBenchmark(size_t nodeCount);
\ No newline at end of file
@@ -0,0 +1,175 @@
+#include "Tests.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TransformSystem.h"
+#include "GameObject.h"
+
+#include "Check.h"
+
+namespace
+{
+	const int ITERATION_COUNT = 10;
+
+	struct Scene
+	{
+		Scene() : transformSystem(std::make_shared<TransformSystem>())
+		{
+			manager.registerSystem(transformSystem);
+		}
+
+		EntityManager manager;
+		std::shared_ptr<TransformSystem> transformSystem;
+		std::vector<GameObject*> objects;
+	};
+
+	GameObject* createObject(Scene& scene, std::mt19937& random)
+	{
+		GameObject* object = scene.manager.getObject(scene.manager.create()->getId());
+		object->setPosition(static_cast<float>(random() % 10) * 0.1f, static_cast<float>(random() % 10) * 0.1f, 0.0f);
+		object->setRotation(static_cast<float>(random() % 90), 0.0f, 0.0f);
+		scene.objects.push_back(object);
+		return object;
+	}
+
+	// 16 long chains, then binary tree below them
+	void createDeepScene(Scene& scene, size_t count)
+	{
+		std::mt19937 random(3);
+		for (size_t i = 0; i < count; ++i) {
+			GameObject* object = createObject(scene, random);
+			if (i >= 16) {
+				object->setParent(scene.objects[i < 2000 ? i - 16 : i / 2]);
+			}
+		}
+	}
+
+	// Like imported models: root, some nodes and many meshes below them
+	void createShallowScene(Scene& scene, size_t count)
+	{
+		std::mt19937 random(5);
+		GameObject* root = createObject(scene, random);
+
+		const size_t nodeCount = 100;
+		for (size_t i = 0; i < nodeCount; ++i) {
+			createObject(scene, random)->setParent(root);
+		}
+
+		for (size_t i = nodeCount + 1; i < count; ++i) {
+			createObject(scene, random)->setParent(scene.objects[1 + i % nodeCount]);
+		}
+	}
+
+	// World transformations by depth first walk from roots, without
+	// level order, parallelism or SIMD
+	void walk(const Scene& scene, std::vector<mat4>& result)
+	{
+		std::vector<std::pair<const GameObject*, mat4>> stack;
+		for (const GameObject* object : scene.objects) {
+			if (object->getParent() == nullptr) {
+				stack.emplace_back(object, mat4(1.0f));
+			}
+		}
+
+		while (!stack.empty()) {
+			const GameObject* object = stack.back().first;
+			const mat4 transformation = stack.back().second * object->getTransformationMatrix();
+			stack.pop_back();
+
+			result[object->getId().getIndex()] = transformation;
+			for (const GameObject* child = object->getFirstChild(); child != nullptr; child = child->getNextSibling()) {
+				stack.emplace_back(child, transformation);
+			}
+		}
+	}
+
+	bool isNear(const mat4& a, const mat4& b)
+	{
+		for (glm::length_t i = 0; i < 4; ++i) {
+			for (glm::length_t j = 0; j < 4; ++j) {
+				if (std::abs(a[i][j] - b[i][j]) > 1e-3f * (1.0f + std::abs(a[i][j]))) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
+	// Marks objects dirty outside of measured time
+	template<typename Func>
+	double measure(Scene& scene, size_t dirtyStep, Func&& func)
+	{
+		double milliseconds = 0.0;
+		for (int i = 0; i < ITERATION_COUNT; ++i) {
+			for (size_t j = i % dirtyStep; j < scene.objects.size(); j += dirtyStep) {
+				scene.objects[j]->move(0.0f, 0.001f, 0.0f);
+			}
+
+			Stopwatch time;
+			func();
+			milliseconds += time.getMilliseconds();
+		}
+		return milliseconds / ITERATION_COUNT;
+	}
+
+	void runScene(const std::string& name, Scene& scene, size_t threadCount)
+	{
+		std::vector<mat4> walked(scene.manager.getCapacity());
+
+		// first update builds level order
+		scene.manager.update(0.0f);
+
+		const double walkMilliseconds = measure(scene, 1, [&scene, &walked]() {
+			walk(scene, walked);
+		});
+		const double allDirtyMilliseconds = measure(scene, 1, [&scene]() {
+			scene.manager.update(0.0f);
+		});
+		const double someDirtyMilliseconds = measure(scene, 100, [&scene]() {
+			scene.manager.update(0.0f);
+		});
+
+		// both ways give the same world transformations
+		walk(scene, walked);
+		for (const GameObject* object : scene.objects) {
+			CHECK(isNear(scene.transformSystem->getWorldTransformation(object->getId()), walked[object->getId().getIndex()]));
+		}
+
+		std::printf("transform %s: %zu nodes, %zu levels, %zu threads, walk %.2f ms, system all dirty %.2f ms, 1%% dirty %.2f ms\n",
+			name.c_str(), scene.objects.size(), scene.transformSystem->getLevelCount(), threadCount,
+			walkMilliseconds, allDirtyMilliseconds, someDirtyMilliseconds);
+	}
+}
+
+void runTransformBenchmark(size_t nodeCount)
+{
+	const size_t maxThreadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+	std::vector<size_t> threadCounts = { 1 };
+	if (maxThreadCount > 1) {
+		threadCounts.push_back(maxThreadCount);
+	}
+
+	for (auto threadCount : threadCounts) {
+		// without workers jobs run on the calling thread
+		if (threadCount > 1) {
+			JobSystem::init(threadCount - 1);
+		}
+
+		Scene deepScene;
+		createDeepScene(deepScene, nodeCount);
+		runScene("deep", deepScene, threadCount);
+
+		Scene shallowScene;
+		createShallowScene(shallowScene, nodeCount);
+		runScene("shallow", shallowScene, threadCount);
+
+		JobSystem::close();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Tests.h"
+
+// Runs tests, then benchmarks
+// --tests-only skips benchmarks
+int main(int argc, char** argv)
+{
+	const bool runBenchmarks = argc < 2 || std::string(argv[1]) != "--tests-only";
+
+	const std::vector<std::pair<std::string, std::function<void()>>> tests = {
+		{ "snapshot", runSnapshotTests },
+	};
+
+	int failedCount = 0;
+	for (const auto& test : tests) {
+		try {
+			test.second();
+			std::cout << "[ OK ] " << test.first << std::endl;
+		}
+		catch (const std::exception& e) {
+			std::cout << "[FAIL] " << test.first << ": " << e.what() << std::endl;
+			++failedCount;
+		}
+	}
+
+	if (failedCount == 0 && runBenchmarks) {
+		runSnapshotBenchmark(1000000);
+		runParallelEachBenchmark(1000000);
+		runTransformBenchmark(200000);
+	}
+
+	return failedCount == 0 ? 0 : 1;
+}
\ No newline at end of file